@@ -0,0 +1,240 @@
+#pragma once
+
+#include "sbp.hpp"
+
+#include <cerrno>
+
+#if defined(_WIN32)
+	#include <io.h>
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace sbp {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Read-only memory mapped file, use view() to decode messages directly from the mapped memory
+class mapped_file final
+{
+public:
+	mapped_file() SBP_NOEXCEPT = default;
+
+	explicit mapped_file( const char *path ) SBP_NOEXCEPT { open( path ); }
+
+	mapped_file( const mapped_file & ) = delete;
+
+	~mapped_file() { close(); }
+
+	mapped_file &operator=( const mapped_file & ) = delete;
+
+	bool open( const char *path ) SBP_NOEXCEPT;
+
+	void close() SBP_NOEXCEPT;
+
+	bool is_open() const SBP_NOEXCEPT { return _isOpen; }
+
+	const uint8_t *data() const SBP_NOEXCEPT { return _data; }
+
+	size_t size() const SBP_NOEXCEPT { return _size; }
+
+	buffer view() const SBP_NOEXCEPT { return buffer( _data, _size ); }
+
+private:
+	const uint8_t *_data = nullptr;
+	size_t _size = 0;
+	bool _isOpen = false;
+
+#if defined(_WIN32)
+	HANDLE _file = INVALID_HANDLE_VALUE;
+	HANDLE _mapping = nullptr;
+#endif
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool mapped_file::open( const char *path ) SBP_NOEXCEPT
+{
+	close();
+
+#if defined(_WIN32)
+	_file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+	if ( _file == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER fileSize = { };
+	if ( !GetFileSizeEx( _file, &fileSize ) )
+	{
+		close();
+		return false;
+	}
+
+	_size = static_cast<size_t>( fileSize.QuadPart );
+	_isOpen = true;
+
+	// Empty files cannot be mapped
+	if ( _size == 0 )
+		return true;
+
+	_mapping = CreateFileMappingA( _file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if ( !_mapping )
+	{
+		close();
+		return false;
+	}
+
+	_data = static_cast<const uint8_t *>( MapViewOfFile( _mapping, FILE_MAP_READ, 0, 0, 0 ) );
+	if ( !_data )
+	{
+		close();
+		return false;
+	}
+#else
+	int fd = ::open( path, O_RDONLY );
+	if ( fd < 0 )
+		return false;
+
+	struct stat st = { };
+	if ( fstat( fd, &st ) != 0 )
+	{
+		::close( fd );
+		return false;
+	}
+
+	_size = static_cast<size_t>( st.st_size );
+	_isOpen = true;
+
+	// Empty files cannot be mapped
+	if ( _size > 0 )
+	{
+		void *data = mmap( nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if ( data == MAP_FAILED )
+		{
+			::close( fd );
+			close();
+			return false;
+		}
+
+		madvise( data, _size, MADV_SEQUENTIAL );
+		_data = static_cast<const uint8_t *>( data );
+	}
+
+	// Mapping stays valid after closing the descriptor
+	::close( fd );
+#endif
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void mapped_file::close() SBP_NOEXCEPT
+{
+#if defined(_WIN32)
+	if ( _data )
+		UnmapViewOfFile( _data );
+
+	if ( _mapping )
+		CloseHandle( _mapping );
+
+	if ( _file != INVALID_HANDLE_VALUE )
+		CloseHandle( _file );
+
+	_mapping = nullptr;
+	_file = INVALID_HANDLE_VALUE;
+#else
+	if ( _data )
+		munmap( const_cast<uint8_t *>( _data ), _size );
+#endif
+
+	_data = nullptr;
+	_size = 0;
+	_isOpen = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+// Flush callback for stream_writer, userData is a file descriptor (CRT file descriptor on Windows)
+inline bool flush_to_fd( void *userData, const void *data, size_t numBytes ) SBP_NOEXCEPT
+{
+	auto fd = static_cast<int>( reinterpret_cast<intptr_t>( userData ) );
+	auto *cursor = static_cast<const uint8_t *>( data );
+
+	while ( numBytes > 0 )
+	{
+#if defined(_WIN32)
+		auto chunkSize = static_cast<unsigned>( ( numBytes > 0x40000000u ) ? 0x40000000u : numBytes );
+		auto result = _write( fd, cursor, chunkSize );
+#else
+		auto result = ::write( fd, cursor, numBytes );
+#endif
+
+		if ( result < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+
+			return false;
+		}
+
+		cursor += result;
+		numBytes -= static_cast<size_t>( result );
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Stream writer flushing into a file descriptor (file, pipe, blocking socket...), descriptor is not closed
+class fd_writer final : public stream_writer
+{
+public:
+	explicit fd_writer( int fd, size_t windowSize = default_window_size ) SBP_NOEXCEPT
+		: stream_writer( flush_to_fd, reinterpret_cast<void *>( static_cast<intptr_t>( fd ) ), windowSize )
+	{
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+// Source callback for stream_reader, userData is a file descriptor (CRT file descriptor on Windows)
+inline size_t read_from_fd( void *userData, void *data, size_t maxBytes ) SBP_NOEXCEPT
+{
+	auto fd = static_cast<int>( reinterpret_cast<intptr_t>( userData ) );
+
+	for ( ;; )
+	{
+#if defined(_WIN32)
+		auto chunkSize = static_cast<unsigned>( ( maxBytes > 0x40000000u ) ? 0x40000000u : maxBytes );
+		auto result = _read( fd, data, chunkSize );
+#else
+		auto result = ::read( fd, data, maxBytes );
+#endif
+
+		if ( result >= 0 )
+			return static_cast<size_t>( result );
+		else if ( errno != EINTR )
+			return 0;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Stream reader pulling data from a file descriptor, descriptor is not closed
+class fd_reader final : public stream_reader
+{
+public:
+	explicit fd_reader( int fd, size_t windowSize = default_window_size, size_t maxWindowSize = default_max_window_size ) SBP_NOEXCEPT
+		: stream_reader( read_from_fd, reinterpret_cast<void *>( static_cast<intptr_t>( fd ) ), windowSize, maxWindowSize )
+	{
+#if defined(POSIX_FADV_SEQUENTIAL)
+		// Let the kernel read ahead, so disk I/O overlaps with decoding
+		posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+	}
+};
+
+} // namespace sbp
@@ -0,0 +1,594 @@
+#pragma once
+
+#include "sbp.hpp"
+
+namespace sbp::detail {
+
+// Compressed data are a sequence of frames, every frame starts with raw size and compressed size (both uint32,
+// little-endian). Compressed size with the highest bit set means the data are stored as they are.
+constexpr size_t lz_frame_header_size = 2 * sizeof( uint32_t );
+constexpr uint32_t lz_stored_flag = 0x80000000u;
+
+// Larger data are split into multiple frames, decoder refuses larger frames (so corrupted data cannot make it allocate)
+constexpr size_t lz_max_frame_size = 16 * 1024 * 1024;
+
+// Frame payload is LZ4-like block of sequences: token (literal length and match length nibbles), literals,
+// 2-byte match offset. Matches are at least 4 bytes long and the last bytes are always literals.
+constexpr size_t lz_min_match = 4;
+constexpr size_t lz_max_offset = 65535;
+constexpr size_t lz_last_literals = 5;
+constexpr size_t lz_match_find_limit = 12;
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE uint32_t lz_load32( const uint8_t *data ) SBP_NOEXCEPT
+{
+	uint32_t value;
+	memcpy( &value, data, sizeof( value ) );
+	return value;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE uint32_t lz_trailing_zeros( uint64_t value ) SBP_NOEXCEPT
+{
+#if defined(SBP_MSVC)
+	unsigned long index = 0;
+	_BitScanForward64( &index, value );
+	return uint32_t( index );
+#else
+	return uint32_t( __builtin_ctzll( value ) );
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Worst case size of a compressed block (incompressible data are just literals)
+constexpr size_t lz_max_block_size( size_t numBytes ) SBP_NOEXCEPT { return numBytes + numBytes / 255 + 16; }
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE uint8_t *lz_write_length( uint8_t *output, size_t length ) SBP_NOEXCEPT
+{
+	for ( length -= 15; length >= 255; length -= 255 )
+		*output++ = 255;
+
+	*output++ = static_cast<uint8_t>( length );
+	return output;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE bool lz_read_length( const uint8_t *&input, const uint8_t *end, size_t &length ) SBP_NOEXCEPT
+{
+	for ( ;; )
+	{
+		if ( input >= end )
+			return false;
+
+		uint8_t value = *input++;
+		length += value;
+
+		if ( value != 255 )
+			return true;
+	}
+}
+
+// Single-threaded compressor state (hash table of recent positions), reused for all frames
+class lz_compressor final
+{
+public:
+	explicit lz_compressor( int level ) SBP_NOEXCEPT;
+
+	lz_compressor( const lz_compressor & ) = delete;
+
+	~lz_compressor() { delete[] _table; }
+
+	lz_compressor &operator=( const lz_compressor & ) = delete;
+
+	// Writes a single frame (header included), output must hold lz_frame_header_size + lz_max_block_size( numBytes )
+	// bytes. Returns size of the frame.
+	size_t compress_frame( const uint8_t *data, size_t numBytes, uint8_t *output ) SBP_NOEXCEPT;
+
+private:
+	size_t compress_block( const uint8_t *data, size_t numBytes, uint8_t *output ) SBP_NOEXCEPT;
+
+	uint32_t *_table = nullptr;
+	uint32_t _hashBits = 0;
+
+	// Search step grows after 2^_skipStrength misses in a row, so incompressible data are skipped quickly
+	uint32_t _skipStrength = 0;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+inline lz_compressor::lz_compressor( int level ) SBP_NOEXCEPT
+{
+	level = ( level < 1 ) ? 1 : ( level > 9 ) ? 9 : level;
+
+	// Higher levels remember more positions and give up on incompressible data later
+	_hashBits = 10 + static_cast<uint32_t>( level );
+	_skipStrength = 3 + static_cast<uint32_t>( level );
+	_table = new uint32_t[size_t( 1 ) << _hashBits];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t lz_compressor::compress_frame( const uint8_t *data, size_t numBytes, uint8_t *output ) SBP_NOEXCEPT
+{
+	auto rawSize = static_cast<uint32_t>( numBytes );
+	auto packedSize = static_cast<uint32_t>( compress_block( data, numBytes, output + lz_frame_header_size ) );
+
+	// Data, which do not get any smaller, are stored as they are, so decoding them is just a copy
+	if ( packedSize >= rawSize )
+	{
+		memcpy( output + lz_frame_header_size, data, numBytes );
+		packedSize = rawSize | lz_stored_flag;
+	}
+
+	memcpy( output, &rawSize, sizeof( rawSize ) );
+	memcpy( output + sizeof( rawSize ), &packedSize, sizeof( packedSize ) );
+	return lz_frame_header_size + ( packedSize & ~lz_stored_flag );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t lz_compressor::compress_block( const uint8_t *data, size_t numBytes, uint8_t *output ) SBP_NOEXCEPT
+{
+	const uint8_t *input = data;
+	const uint8_t *anchor = data;
+	const uint8_t *end = data + numBytes;
+	uint8_t *cursor = output;
+
+	if ( numBytes > lz_match_find_limit )
+	{
+		const uint8_t *matchLimit = end - lz_last_literals;
+		const uint8_t *findLimit = end - lz_match_find_limit;
+
+		// Small inputs do not need the whole table
+		uint32_t hashBits = _hashBits;
+		while ( hashBits > 10 && ( size_t( 1 ) << ( hashBits - 2 ) ) > numBytes )
+			--hashBits;
+
+		memset( _table, 0, sizeof( uint32_t ) << hashBits );
+		auto hash = [hashBits]( uint32_t sequence ) { return ( sequence * 2654435761u ) >> ( 32 - hashBits ); };
+
+		++input;
+
+		while ( input < findLimit )
+		{
+			const uint8_t *match = nullptr;
+			size_t numAttempts = size_t( 1 ) << _skipStrength;
+
+			for ( size_t step = 1; ; step = numAttempts++ >> _skipStrength )
+			{
+				uint32_t sequence = lz_load32( input );
+				auto &entry = _table[hash( sequence )];
+
+				match = data + entry;
+				entry = static_cast<uint32_t>( input - data );
+
+				if ( match < input && static_cast<size_t>( input - match ) <= lz_max_offset && lz_load32( match ) == sequence )
+					break;
+
+				input += step;
+				if ( input >= findLimit )
+					goto last_literals;
+			}
+
+			// Match might start earlier
+			while ( input > anchor && match > data && input[-1] == match[-1] )
+			{
+				--input;
+				--match;
+			}
+
+			// Match continues 8 bytes at a time, first different byte is found from the xor of both words
+			const uint8_t *matchEnd = input + lz_min_match;
+			const uint8_t *source = match + lz_min_match;
+
+			while ( matchEnd + sizeof( uint64_t ) <= matchLimit )
+			{
+				uint64_t a, b;
+				memcpy( &a, matchEnd, sizeof( a ) );
+				memcpy( &b, source, sizeof( b ) );
+
+				if ( a != b )
+				{
+					matchEnd += lz_trailing_zeros( a ^ b ) / 8;
+					goto match_found;
+				}
+
+				matchEnd += sizeof( uint64_t );
+				source += sizeof( uint64_t );
+			}
+
+			while ( matchEnd < matchLimit && *matchEnd == *source )
+			{
+				++matchEnd;
+				++source;
+			}
+
+		match_found:
+			auto numLiterals = static_cast<size_t>( input - anchor );
+			auto matchLength = static_cast<size_t>( matchEnd - input ) - lz_min_match;
+			auto offset = static_cast<uint16_t>( input - match );
+
+			uint8_t *token = cursor++;
+			*token = static_cast<uint8_t>( ( ( numLiterals < 15 ) ? numLiterals : 15 ) << 4 );
+			if ( numLiterals >= 15 )
+				cursor = lz_write_length( cursor, numLiterals );
+
+			memcpy( cursor, anchor, numLiterals );
+			cursor += numLiterals;
+
+			memcpy( cursor, &offset, sizeof( offset ) );
+			cursor += sizeof( offset );
+
+			*token |= static_cast<uint8_t>( ( matchLength < 15 ) ? matchLength : 15 );
+			if ( matchLength >= 15 )
+				cursor = lz_write_length( cursor, matchLength );
+
+			input = anchor = matchEnd;
+
+			// Position inside the match helps to find the next one
+			if ( input < findLimit )
+				_table[hash( lz_load32( input - 2 ) )] = static_cast<uint32_t>( input - 2 - data );
+		}
+	}
+
+last_literals:
+	auto numLiterals = static_cast<size_t>( end - anchor );
+
+	*cursor++ = static_cast<uint8_t>( ( ( numLiterals < 15 ) ? numLiterals : 15 ) << 4 );
+	if ( numLiterals >= 15 )
+		cursor = lz_write_length( cursor, numLiterals );
+
+	memcpy( cursor, anchor, numLiterals );
+	cursor += numLiterals;
+
+	return static_cast<size_t>( cursor - output );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Decodes a single block, output must be exactly numBytes long (every access is checked, so corrupted data are safe)
+inline error lz_decompress_block( const uint8_t *data, size_t dataSize, uint8_t *output, size_t numBytes ) SBP_NOEXCEPT
+{
+	const uint8_t *input = data;
+	const uint8_t *inputEnd = data + dataSize;
+	uint8_t *cursor = output;
+	uint8_t *end = output + numBytes;
+
+	for ( ;; )
+	{
+		if ( input >= inputEnd )
+			return { error::corrupted_data };
+
+		uint8_t token = *input++;
+
+		size_t numLiterals = token >> 4;
+		if ( numLiterals == 15 && !lz_read_length( input, inputEnd, numLiterals ) )
+			return { error::corrupted_data };
+
+		if ( numLiterals > static_cast<size_t>( inputEnd - input ) || numLiterals > static_cast<size_t>( end - cursor ) )
+			return { error::corrupted_data };
+
+		// Short literals are copied as a whole word, when there is enough space on both sides
+		if ( numLiterals <= 16 && inputEnd - input >= 16 && end - cursor >= 16 )
+			memcpy( cursor, input, 16 );
+		else
+			memcpy( cursor, input, numLiterals );
+
+		cursor += numLiterals;
+		input += numLiterals;
+
+		// Last sequence has no match
+		if ( input == inputEnd )
+			break;
+
+		if ( inputEnd - input < 2 )
+			return { error::corrupted_data };
+
+		size_t offset = input[0] | ( size_t( input[1] ) << 8 );
+		input += 2;
+
+		if ( offset == 0 || offset > static_cast<size_t>( cursor - output ) )
+			return { error::corrupted_data };
+
+		size_t matchLength = token & 15u;
+		if ( matchLength == 15 && !lz_read_length( input, inputEnd, matchLength ) )
+			return { error::corrupted_data };
+
+		matchLength += lz_min_match;
+		if ( matchLength > static_cast<size_t>( end - cursor ) )
+			return { error::corrupted_data };
+
+		const uint8_t *match = cursor - offset;
+
+		if ( offset >= 16 && static_cast<size_t>( end - cursor ) >= matchLength + 16 )
+		{
+			// Chunks do not overlap, copying past the match end is fine as there is space left
+			for ( size_t i = 0; i < matchLength; i += 16 )
+				memcpy( cursor + i, match + i, 16 );
+		}
+		else if ( offset >= 8 && static_cast<size_t>( end - cursor ) >= matchLength + 8 )
+		{
+			for ( size_t i = 0; i < matchLength; i += 8 )
+				memcpy( cursor + i, match + i, 8 );
+		}
+		else
+		{
+			// Overlapping match repeats the last offset bytes
+			for ( size_t i = 0; i < matchLength; ++i )
+				cursor[i] = match[i];
+		}
+
+		cursor += matchLength;
+	}
+
+	return ( cursor == end ) ? error() : error{ error::corrupted_data };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reads frame header, returns false when the header is not valid
+SBP_FORCE_INLINE bool lz_read_frame_header( const uint8_t *data, uint32_t &rawSize, uint32_t &packedSize, bool &stored ) SBP_NOEXCEPT
+{
+	memcpy( &rawSize, data, sizeof( rawSize ) );
+	memcpy( &packedSize, data + sizeof( rawSize ), sizeof( packedSize ) );
+
+	stored = ( packedSize & lz_stored_flag ) != 0;
+	packedSize &= ~lz_stored_flag;
+
+	if ( rawSize > lz_max_frame_size || packedSize > lz_max_block_size( rawSize ) )
+		return false;
+
+	return !stored || packedSize == rawSize;
+}
+
+} // namespace sbp::detail
+
+namespace sbp {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Compression level, 1 is the fastest, 9 compresses best
+constexpr int default_compression_level = 3;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Upper bound of compress output size
+constexpr size_t max_compressed_size( size_t numBytes ) SBP_NOEXCEPT
+{
+	auto numFrames = ( numBytes + detail::lz_max_frame_size - 1 ) / detail::lz_max_frame_size;
+	return numFrames * detail::lz_frame_header_size + numBytes;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Appends compressed data to output, compressing directly into output memory
+inline void compress( const void *data, size_t numBytes, buffer &output, int level = default_compression_level ) SBP_NOEXCEPT
+{
+	detail::lz_compressor compressor( level );
+	auto *input = static_cast<const uint8_t *>( data );
+
+	while ( numBytes > 0 )
+	{
+		size_t frameSize = ( numBytes < detail::lz_max_frame_size ) ? numBytes : detail::lz_max_frame_size;
+
+		uint8_t *cursor = output.prepare_write( detail::lz_frame_header_size + detail::lz_max_block_size( frameSize ) );
+		output.commit_write( cursor + compressor.compress_frame( input, frameSize, cursor ) );
+
+		input += frameSize;
+		numBytes -= frameSize;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Appends decompressed data to output, frames are decoded directly into output memory
+inline error decompress( const void *data, size_t numBytes, buffer &output ) SBP_NOEXCEPT
+{
+	auto *input = static_cast<const uint8_t *>( data );
+	auto *end = input + numBytes;
+
+	while ( input < end )
+	{
+		uint32_t rawSize = 0, packedSize = 0;
+		bool stored = false;
+
+		if ( static_cast<size_t>( end - input ) < detail::lz_frame_header_size )
+			return { error::unexpected_end };
+
+		if ( !detail::lz_read_frame_header( input, rawSize, packedSize, stored ) )
+			return { error::corrupted_data };
+
+		input += detail::lz_frame_header_size;
+		if ( static_cast<size_t>( end - input ) < packedSize )
+			return { error::unexpected_end };
+
+		uint8_t *cursor = output.prepare_write( rawSize );
+
+		if ( stored )
+			memcpy( cursor, input, rawSize );
+		else if ( auto err = detail::lz_decompress_block( input, packedSize, cursor, rawSize ) )
+			return err;
+
+		output.commit_write( cursor + rawSize );
+		input += packedSize;
+	}
+
+	return { error::none };
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Stream writer compressing every flushed window as a single frame before passing it to the flush callback
+class compressed_writer final : public stream_writer
+{
+public:
+	compressed_writer( flush_callback callback, void *userData, int level = default_compression_level,
+	                   size_t windowSize = default_window_size ) SBP_NOEXCEPT
+		: stream_writer( flush_frames, this, windowSize )
+		, _output( callback )
+		, _outputUserData( userData )
+		, _compressor( level )
+	{
+	}
+
+	// Remaining data must be compressed before members are gone
+	~compressed_writer() { flush(); }
+
+private:
+	static bool flush_frames( void *userData, const void *data, size_t numBytes ) SBP_NOEXCEPT;
+
+	flush_callback _output = nullptr;
+	void *_outputUserData = nullptr;
+	detail::lz_compressor _compressor;
+
+	// Compressed frame
+	buffer _frame;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool compressed_writer::flush_frames( void *userData, const void *data, size_t numBytes ) SBP_NOEXCEPT
+{
+	auto &self = *static_cast<compressed_writer *>( userData );
+	auto *input = static_cast<const uint8_t *>( data );
+
+	// Data larger than the window bypass it, they still have to be split into frames
+	while ( numBytes > 0 )
+	{
+		size_t frameSize = ( numBytes < detail::lz_max_frame_size ) ? numBytes : detail::lz_max_frame_size;
+
+		self._frame.reset( false );
+		uint8_t *cursor = self._frame.prepare_write( detail::lz_frame_header_size + detail::lz_max_block_size( frameSize ) );
+		size_t packedSize = self._compressor.compress_frame( input, frameSize, cursor );
+
+		if ( !self._output( self._outputUserData, cursor, packedSize ) )
+			return false;
+
+		input += frameSize;
+		numBytes -= frameSize;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Stream reader decompressing frames from the source callback. Frames, which fit into free space of the window, are
+// decompressed directly into it. Corrupted or truncated stream ends decoding as if the stream ended, status() tells
+// the difference.
+class compressed_reader final : public stream_reader
+{
+public:
+	compressed_reader( source_callback callback, void *userData, size_t windowSize = default_window_size,
+	                   size_t maxWindowSize = default_max_window_size ) SBP_NOEXCEPT
+		: stream_reader( read_frames, this, windowSize, maxWindowSize )
+		, _input( callback )
+		, _inputUserData( userData )
+	{
+	}
+
+	error status() const SBP_NOEXCEPT { return _status; }
+
+private:
+	static size_t read_frames( void *userData, void *data, size_t maxBytes ) SBP_NOEXCEPT;
+
+	// Reads exactly numBytes from the source, returns number of bytes actually read
+	size_t read_input( void *data, size_t numBytes ) SBP_NOEXCEPT;
+
+	source_callback _input = nullptr;
+	void *_inputUserData = nullptr;
+	error _status;
+
+	// Compressed frame
+	buffer _packed;
+
+	// Decompressed frame, which did not fit into the window
+	buffer _pending;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t compressed_reader::read_input( void *data, size_t numBytes ) SBP_NOEXCEPT
+{
+	auto *cursor = static_cast<uint8_t *>( data );
+	size_t total = 0;
+
+	while ( total < numBytes )
+	{
+		auto numRead = _input( _inputUserData, cursor + total, numBytes - total );
+		if ( numRead == 0 )
+			break;
+
+		total += numRead;
+	}
+
+	return total;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t compressed_reader::read_frames( void *userData, void *data, size_t maxBytes ) SBP_NOEXCEPT
+{
+	auto &self = *static_cast<compressed_reader *>( userData );
+
+	// Rest of the frame, which did not fit into the window last time
+	if ( auto numPending = self._pending.size() - self._pending.tell(); numPending > 0 )
+	{
+		auto numBytes = ( numPending < maxBytes ) ? numPending : maxBytes;
+		self._pending.read( data, numBytes );
+		return numBytes;
+	}
+
+	while ( !self._status )
+	{
+		uint8_t header[detail::lz_frame_header_size];
+		uint32_t rawSize = 0, packedSize = 0;
+		bool stored = false;
+
+		// End of stream is only allowed between frames
+		if ( auto numRead = self.read_input( header, sizeof( header ) ); numRead != sizeof( header ) )
+		{
+			if ( numRead > 0 )
+				self._status = { error::unexpected_end };
+
+			break;
+		}
+
+		if ( !detail::lz_read_frame_header( header, rawSize, packedSize, stored ) )
+		{
+			self._status = { error::corrupted_data };
+			break;
+		}
+
+		if ( rawSize == 0 )
+			continue;
+
+		// Decoded directly into the window when possible
+		bool direct = ( rawSize <= maxBytes );
+		self._pending.reset( false );
+		uint8_t *output = direct ? static_cast<uint8_t *>( data ) : self._pending.prepare_write( rawSize );
+
+		if ( stored )
+		{
+			if ( self.read_input( output, rawSize ) != rawSize )
+			{
+				self._status = { error::unexpected_end };
+				break;
+			}
+		}
+		else
+		{
+			self._packed.reset( false );
+			uint8_t *packed = self._packed.prepare_write( packedSize );
+
+			if ( self.read_input( packed, packedSize ) != packedSize )
+			{
+				self._status = { error::unexpected_end };
+				break;
+			}
+
+			if ( ( self._status = detail::lz_decompress_block( packed, packedSize, output, rawSize ) ) )
+				break;
+		}
+
+		if ( direct )
+			return rawSize;
+
+		self._pending.commit_write( output + rawSize );
+		return read_frames( userData, data, maxBytes );
+	}
+
+	return 0;
+}
+
+} // namespace sbp
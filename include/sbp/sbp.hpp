@@ -16,9 +16,18 @@
 	#endif
 #endif
 
+#if !defined(SBP_NOINLINE)
+	#if defined(SBP_MSVC)
+		#define SBP_NOINLINE __declspec(noinline)
+	#else
+		#define SBP_NOINLINE __attribute__((noinline, cold))
+	#endif
+#endif
+
 #if !defined(SBP_EXTENSION)
 #define SBP_EXTENSION(_Type, _TypeID) namespace sbp::detail { \
-	inline void write( buffer &b, const _Type &value ) { write_ext<sizeof(_Type)>(b, (_TypeID), &value); } \
+	template <> struct extension<_Type> { static constexpr int8_t type_id = (_TypeID); }; \
+	template <typename Buffer> inline void write( Buffer &b, const _Type &value ) { write_ext<sizeof(_Type)>(b, (_TypeID), &value); } \
 	inline error read( buffer &b, _Type &value ) { \
 		const void* data = nullptr; \
 		if (auto err = read_ext<sizeof(_Type), (_TypeID)>(b, data)) return err; \
@@ -30,6 +39,151 @@
 #include <cstdint>
 #include <cstring>
 #include <type_traits>
+#include <utility>
+
+#if defined(SBP_MSVC)
+	#include <intrin.h>
+	#include <stdlib.h>
+#endif
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#endif
+
+namespace sbp::detail {
+
+// Empty base of sbp::buffer, makes all sbp::detail overloads visible via ADL (including those declared later)
+struct adl_base { };
+
+// Specialized by SBP_EXTENSION macro
+template <typename T>
+struct extension { };
+
+template <typename T, typename = void>
+struct is_extension : std::false_type { };
+
+template <typename T>
+struct is_extension<T, std::void_t<decltype( extension<T>::type_id )>> : std::true_type { };
+
+template <typename T>
+constexpr bool is_extension_v = is_extension<T>::value;
+
+// Types, which can be stored as a single bin/ext blob when inside an array
+template <typename T>
+constexpr bool is_packable_v = ( std::is_arithmetic_v<T> && !std::is_same_v<T, bool> ) ||
+                               ( is_extension_v<T> && std::is_trivially_copyable_v<T> );
+
+#if defined(SBP_PACKED_ARRAYS)
+template <typename T>
+constexpr bool use_packed_v = is_packable_v<T>;
+#else
+template <typename T>
+constexpr bool use_packed_v = false;
+#endif
+
+// MSVC only targets little-endian platforms
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && ( __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ )
+constexpr bool host_big_endian = true;
+#else
+constexpr bool host_big_endian = false;
+#endif
+
+// Values are stored in host byte order, unless SBP_BIG_ENDIAN asks for big-endian (as MessagePack spec requires)
+#if defined(SBP_BIG_ENDIAN)
+constexpr bool swap_wire_order = !host_big_endian;
+#else
+constexpr bool swap_wire_order = false;
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+#if defined(SBP_MSVC)
+SBP_FORCE_INLINE uint16_t byte_swap( uint16_t value ) SBP_NOEXCEPT { return _byteswap_ushort( value ); }
+SBP_FORCE_INLINE uint32_t byte_swap( uint32_t value ) SBP_NOEXCEPT { return _byteswap_ulong( value ); }
+SBP_FORCE_INLINE uint64_t byte_swap( uint64_t value ) SBP_NOEXCEPT { return _byteswap_uint64( value ); }
+#else
+SBP_FORCE_INLINE uint16_t byte_swap( uint16_t value ) SBP_NOEXCEPT { return __builtin_bswap16( value ); }
+SBP_FORCE_INLINE uint32_t byte_swap( uint32_t value ) SBP_NOEXCEPT { return __builtin_bswap32( value ); }
+SBP_FORCE_INLINE uint64_t byte_swap( uint64_t value ) SBP_NOEXCEPT { return __builtin_bswap64( value ); }
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+// Converts arithmetic value between host and wire byte order (both directions are the same swap)
+template <typename T>
+SBP_FORCE_INLINE T wire_order( T value ) SBP_NOEXCEPT
+{
+	if constexpr ( !swap_wire_order || sizeof( T ) == 1 )
+		return value;
+	else
+	{
+		using bits_type = std::conditional_t<sizeof( T ) == 2, uint16_t, std::conditional_t<sizeof( T ) == 4, uint32_t, uint64_t>>;
+		static_assert( sizeof( bits_type ) == sizeof( T ), "wire_order requires 1, 2, 4 or 8 bytes long type" );
+
+		bits_type bits;
+		memcpy( &bits, &value, sizeof( bits ) );
+		bits = byte_swap( bits );
+		memcpy( &value, &bits, sizeof( bits ) );
+		return value;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <size_t Size>
+constexpr auto make_swap_mask() SBP_NOEXCEPT
+{
+	struct mask_type { int8_t bytes[32]; } mask = { };
+
+	// Reverses bytes of every Size-long element within 16-byte lanes
+	for ( size_t i = 0; i < 32; ++i )
+		mask.bytes[i] = static_cast<int8_t>( ( i % 16 ) / Size * Size + ( Size - 1 - i % Size ) );
+
+	return mask;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Copies numValues elements of Size bytes each, reversing bytes of every element (source and destination may be
+// unaligned, but must not overlap)
+template <size_t Size>
+inline void copy_swapped( void *dst, const void *src, size_t numValues ) SBP_NOEXCEPT
+{
+	auto *output = static_cast<uint8_t *>( dst );
+	auto *input = static_cast<const uint8_t *>( src );
+	const uint8_t *end = input + numValues * Size;
+
+#if defined(__AVX2__)
+	static constexpr auto maskBytes = make_swap_mask<Size>();
+	const __m256i mask = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( maskBytes.bytes ) );
+
+	for ( ; end - input >= 32; input += 32, output += 32 )
+	{
+		__m256i data = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( input ) );
+		_mm256_storeu_si256( reinterpret_cast<__m256i *>( output ), _mm256_shuffle_epi8( data, mask ) );
+	}
+#endif
+
+	using bits_type = std::conditional_t<Size == 2, uint16_t, std::conditional_t<Size == 4, uint32_t, uint64_t>>;
+
+	for ( ; input != end; input += Size, output += Size )
+	{
+		bits_type bits;
+		memcpy( &bits, input, Size );
+		bits = byte_swap( bits );
+		memcpy( output, &bits, Size );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Copies packed array elements between host and wire byte order
+// (empty vectors pass null data, which must not reach memcpy)
+template <typename T>
+SBP_FORCE_INLINE void copy_wire_order( T *dst, const void *src, size_t numValues ) SBP_NOEXCEPT
+{
+	if constexpr ( swap_wire_order && std::is_arithmetic_v<T> && sizeof( T ) > 1 )
+		copy_swapped<sizeof( T )>( dst, src, numValues );
+	else if ( numValues > 0 )
+		memcpy( dst, src, sizeof( T ) * numValues );
+}
+
+} // namespace sbp::detail
 
 namespace sbp {
 
@@ -39,7 +193,9 @@ struct error final
 	{
 		none = 0,
 		corrupted_data,
-		unexpected_end
+		unexpected_end,
+		buffer_full,
+		io_error
 	};
 
 	int value = none;
@@ -49,9 +205,27 @@ struct error final
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-class buffer
+// Strings interned by interning_writer, defined in STL section
+class string_table;
+
+class buffer : detail::adl_base
 {
 public:
+	// Frees memory block passed to adopt (or returned from release)
+	using deleter_type = void ( * )( uint8_t *data );
+
+	// Reads up to maxBytes into data, returns number of bytes read (0 at the end of stream)
+	using source_callback = size_t ( * )( void *userData, void *data, size_t maxBytes );
+
+	// Memory block detached from a buffer by release
+	struct memory_block final
+	{
+		uint8_t *data = nullptr;
+		size_t size = 0;
+		size_t capacity = 0;
+		deleter_type deleter = nullptr;
+	};
+
 	buffer() SBP_NOEXCEPT
 	{
 		_data = _stackBuffer;
@@ -59,8 +233,25 @@ public:
 		_endCap = _data + stack_buffer_capacity;
 	}
 
+	// Read-only view of external memory, nothing is copied (first write moves contents into buffer's own memory)
+	buffer( const void *data, size_t size ) SBP_NOEXCEPT
+	{
+		_data = const_cast<uint8_t *>( static_cast<const uint8_t *>( data ) );
+		_readCursor = _data;
+		_writeCursor = _data + size;
+		_endCap = _data;
+	}
+
+	buffer( const buffer & ) = delete;
+
+	buffer( buffer &&other ) SBP_NOEXCEPT : buffer() { *this = std::move( other ); }
+
 	~buffer() { reset(); }
 
+	buffer &operator=( const buffer & ) = delete;
+
+	buffer &operator=( buffer &&other ) SBP_NOEXCEPT;
+
 	uint8_t *data() SBP_NOEXCEPT { return _data; }
 
 	const uint8_t *data() const SBP_NOEXCEPT { return _data; }
@@ -75,6 +266,14 @@ public:
 
 	void reserve( size_t newCapacity ) SBP_NOEXCEPT;
 
+	// Detaches memory block from the buffer (contents of stack buffer are copied to heap first), buffer is empty afterwards
+	memory_block release() SBP_NOEXCEPT;
+
+	// Takes ownership of an existing memory block, deleter is called once the buffer does not need it anymore
+	void adopt( uint8_t *data, size_t size, size_t capacity, deleter_type deleter = default_deleter ) SBP_NOEXCEPT;
+
+	static void default_deleter( uint8_t *data ) SBP_NOEXCEPT { delete[] data; }
+
 	void write( const void *data, size_t numBytes ) SBP_NOEXCEPT;
 
 	template <size_t NumBytes> void write( const void *data ) SBP_NOEXCEPT;
@@ -93,9 +292,49 @@ public:
 
 	const void *seek( size_t offset ) SBP_NOEXCEPT;
 
+	// Returns pointer to numBytes of contiguous data at read cursor and moves the cursor after them
+	const void *acquire( size_t numBytes ) SBP_NOEXCEPT;
+
+	// Moves read cursor after numBytes without looking at them
+	void discard( size_t numBytes ) SBP_NOEXCEPT;
+
+	// True when there is nothing left to read
+	bool eof() SBP_NOEXCEPT { return _readCursor >= _writeCursor && !refill( 1 ); }
+
+	// Makes sure there is space for at least numBytes and returns pointer to the write cursor
+	uint8_t *prepare_write( size_t numBytes ) SBP_NOEXCEPT { ensure_capacity( numBytes ); return _writeCursor; }
+
+	// Moves write cursor after the data written directly into memory returned from prepare_write
+	void commit_write( uint8_t *cursor ) SBP_NOEXCEPT { _writeCursor = cursor; }
+
+	// Moves unread data to the beginning of buffer memory, so already read data do not take up space (offsets and
+	// pointers to buffer memory become invalid)
+	void compact() SBP_NOEXCEPT;
+
+	// Table resolving interned strings written by interning_writer (strings are not interned when null)
+	string_table *strings() const SBP_NOEXCEPT { return _strings; }
+
+	void use_strings( string_table *strings ) SBP_NOEXCEPT { _strings = strings; }
+
+	// True when more data are pulled from a source callback on the way (stream_reader), buffer memory then moves
+	bool has_source() const SBP_NOEXCEPT { return _source != nullptr; }
+
+protected:
+	// Pulls more data from source callback, so at least numBytes are available at read cursor (already read data
+	// are discarded, so offsets and pointers to buffer memory become invalid)
+	bool refill( size_t numBytes ) SBP_NOEXCEPT;
+
+	source_callback _source = nullptr;
+	void *_sourceUserData = nullptr;
+
+	// Refill never grows the window past this size, longer values cannot be acquired
+	size_t _maxWindowSize = 0;
+
 private:
 	void ensure_capacity( size_t NumBytes ) SBP_NOEXCEPT;
 
+	void read_slow( void *data, size_t numBytes ) SBP_NOEXCEPT;
+
 	static constexpr size_t stack_buffer_capacity = 256;
 
 	uint8_t *_data = nullptr;
@@ -104,27 +343,110 @@ private:
 	const uint8_t *_readCursor = nullptr;
 	const uint8_t *_endCap = nullptr;
 
+	// Null when using stack buffer
+	deleter_type _deleter = nullptr;
+
+	string_table *_strings = nullptr;
+
 	uint8_t _stackBuffer[stack_buffer_capacity] = { };
 };
 
+//---------------------------------------------------------------------------------------------------------------------
+inline buffer &buffer::operator=( buffer &&other ) SBP_NOEXCEPT
+{
+	if ( this == &other )
+		return *this;
+
+	reset();
+
+	if ( other._data == other._stackBuffer )
+	{
+		memcpy( _stackBuffer, other._stackBuffer, other.size() );
+		_readCursor = _data + other.tell();
+		_writeCursor = _data + other.size();
+	}
+	else
+	{
+		_data = other._data;
+		_readCursor = other._readCursor;
+		_writeCursor = other._writeCursor;
+		_endCap = other._endCap;
+		_deleter = other._deleter;
+
+		other._data = other._stackBuffer;
+		other._endCap = other._data + stack_buffer_capacity;
+		other._deleter = nullptr;
+	}
+
+	_source = other._source;
+	_sourceUserData = other._sourceUserData;
+	_maxWindowSize = other._maxWindowSize;
+	_strings = other._strings;
+
+	other._readCursor = other._writeCursor = other._data;
+	other._source = nullptr;
+	other._sourceUserData = nullptr;
+	other._maxWindowSize = 0;
+	other._strings = nullptr;
+	return *this;
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 inline void buffer::reset( bool freeMemory ) SBP_NOEXCEPT
 {
 	if ( freeMemory )
 	{
-		if ( _data != _stackBuffer )
-			delete[] _data;
+		if ( _deleter )
+			_deleter( _data );
 
 		_data = _stackBuffer;
 		_endCap = _data + stack_buffer_capacity;
+		_deleter = nullptr;
 	}
 
 	_readCursor = _writeCursor = _data;
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+inline buffer::memory_block buffer::release() SBP_NOEXCEPT
+{
+	memory_block result = { _data, size(), capacity(), _deleter };
+
+	// Stack buffer (or memory not owned by this buffer) has to be copied first, read-only views have no capacity
+	if ( !_deleter )
+	{
+		if ( result.capacity < result.size )
+			result.capacity = result.size;
+
+		result.data = new uint8_t[result.capacity];
+		result.deleter = default_deleter;
+		memcpy( result.data, _data, result.size );
+	}
+
+	_deleter = nullptr;
+	reset();
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void buffer::adopt( uint8_t *data, size_t size, size_t capacity, deleter_type deleter ) SBP_NOEXCEPT
+{
+	reset();
+
+	_data = data;
+	_readCursor = _data;
+	_writeCursor = _data + size;
+	_endCap = _data + capacity;
+	_deleter = deleter;
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 inline void buffer::reserve( size_t newCapacity ) SBP_NOEXCEPT
 {
+	// Read-only views have no capacity, but their data still have to fit
+	if ( newCapacity > capacity() && newCapacity < size() )
+		newCapacity = size();
+
 	if ( newCapacity > capacity() )
 	{
 		auto readOffset = _readCursor - _data;
@@ -133,10 +455,11 @@ inline void buffer::reserve( size_t newCapacity ) SBP_NOEXCEPT
 		auto *newData = new uint8_t[newCapacity];
 		memcpy( newData, _data, writeOffset );
 
-		if ( _data != _stackBuffer )
-			delete[] _data;
+		if ( _deleter )
+			_deleter( _data );
 
 		_data = newData;
+		_deleter = default_deleter;
 		_readCursor = _data + readOffset;
 		_writeCursor = _data + writeOffset;
 		_endCap = _data + newCapacity;
@@ -146,6 +469,10 @@ inline void buffer::reserve( size_t newCapacity ) SBP_NOEXCEPT
 //---------------------------------------------------------------------------------------------------------------------
 SBP_FORCE_INLINE void buffer::write( const void *data, size_t numBytes ) SBP_NOEXCEPT
 {
+	// Empty arrays pass null data, which must not reach memcpy
+	if ( numBytes == 0 )
+		return;
+
 	ensure_capacity( numBytes );
 	memcpy( _writeCursor, data, numBytes );
 	_writeCursor += numBytes;
@@ -157,8 +484,8 @@ SBP_FORCE_INLINE void buffer::write( const void *data ) SBP_NOEXCEPT
 {
 	if constexpr ( NumBytes == 1 )
 	{
-		if ( _writeCursor == _endCap )
-			reserve( capacity() * 2 );
+		if ( _writeCursor >= _endCap )
+			reserve( ( size() + 1 ) * 2 );
 
 		*_writeCursor++ = *reinterpret_cast<const uint8_t *>( data );
 	}
@@ -176,16 +503,18 @@ SBP_FORCE_INLINE void buffer::write( uint8_t header, T &&value ) SBP_NOEXCEPT
 {
 	ensure_capacity( 1 + sizeof( T ) );
 	*_writeCursor++ = header;
-	memcpy( _writeCursor, &value, sizeof( T ) );
+	auto wireValue = detail::wire_order( value );
+	memcpy( _writeCursor, &wireValue, sizeof( T ) );
 	_writeCursor += sizeof( T );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 SBP_FORCE_INLINE void buffer::read( void *data, size_t numBytes ) SBP_NOEXCEPT
 {
-	if ( _readCursor + numBytes <= _writeCursor )
-		memcpy( data, _readCursor, numBytes );
+	if ( _readCursor + numBytes > _writeCursor )
+		return read_slow( data, numBytes );
 
+	memcpy( data, _readCursor, numBytes );
 	_readCursor += numBytes;
 }
 
@@ -193,11 +522,14 @@ SBP_FORCE_INLINE void buffer::read( void *data, size_t numBytes ) SBP_NOEXCEPT
 template <typename T>
 SBP_FORCE_INLINE T buffer::read() SBP_NOEXCEPT
 {
-	if constexpr ( sizeof( T ) == 1 )
-		return ( _readCursor < _writeCursor ) ? *reinterpret_cast<const T *>( _readCursor++ ) : T( 0 );
+	if ( _readCursor + sizeof( T ) > _writeCursor && !refill( sizeof( T ) ) )
+	{
+		_readCursor += sizeof( T );
+		return T( 0 );
+	}
 
 	_readCursor += sizeof( T );
-	return ( _readCursor <= _writeCursor ) ? *reinterpret_cast<const T *>( _readCursor - sizeof( T ) ) : T( 0 );
+	return detail::wire_order( *reinterpret_cast<const T *>( _readCursor - sizeof( T ) ) );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -207,10 +539,10 @@ SBP_FORCE_INLINE error buffer::read( T &result ) SBP_NOEXCEPT
 	if constexpr ( sizeof( T ) < sizeof( RT ) )
 		return { error::corrupted_data };
 
-	if ( _readCursor + sizeof( RT ) > _writeCursor )
+	if ( _readCursor + sizeof( RT ) > _writeCursor && !refill( sizeof( RT ) ) )
 		return { error::unexpected_end };
 
-	result = static_cast<T>( *reinterpret_cast<const RT *>( _readCursor ) );
+	result = static_cast<T>( detail::wire_order( *reinterpret_cast<const RT *>( _readCursor ) ) );
 	_readCursor += sizeof( RT );
 	return { error::none };
 }
@@ -224,841 +556,4731 @@ SBP_FORCE_INLINE const void *buffer::seek( size_t offset ) SBP_NOEXCEPT
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-void buffer::ensure_capacity( size_t NumBytes ) SBP_NOEXCEPT
+SBP_FORCE_INLINE const void *buffer::acquire( size_t numBytes ) SBP_NOEXCEPT
 {
-	if ( _writeCursor + NumBytes > _endCap )
-	{
-		auto cap1 = size() + NumBytes;
-		auto cap2 = capacity() * 3 / 2;
+	if ( _readCursor + numBytes > _writeCursor )
+		refill( numBytes );
 
-		reserve( ( cap1 > cap2 ) ? cap1 : cap2 );
-	}
+	const void *result = _readCursor;
+	_readCursor += numBytes;
+	return result;
 }
 
-} // namespace sbp
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE void buffer::discard( size_t numBytes ) SBP_NOEXCEPT
+{
+	if ( _readCursor + numBytes > _writeCursor )
+		return read_slow( nullptr, numBytes );
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	_readCursor += numBytes;
+}
 
-namespace sbp::detail {
+//---------------------------------------------------------------------------------------------------------------------
+inline void buffer::compact() SBP_NOEXCEPT
+{
+	// Nothing to discard (or read-only view of external memory)
+	if ( _readCursor == _data || _readCursor > _writeCursor || _endCap == _data )
+		return;
+
+	auto numUnread = static_cast<size_t>( _writeCursor - _readCursor );
+	memmove( _data, _readCursor, numUnread );
+	_readCursor = _data;
+	_writeCursor = _data + numUnread;
+}
 
-template <size_t>
-struct any { template <typename T> operator T() const; };
+//---------------------------------------------------------------------------------------------------------------------
+SBP_NOINLINE inline bool buffer::refill( size_t numBytes ) SBP_NOEXCEPT
+{
+	if ( !_source || _readCursor > _writeCursor )
+		return false;
 
-template <typename T, typename In, typename = void>
-struct has_n_members : std::false_type { };
+	compact();
 
-template <typename T, size_t... In>
-struct has_n_members < T, std::index_sequence<In...>, std::void_t < decltype( T { any<In>()... } ) >> :
-std::true_type { };
+	// Single value larger than the whole window, the limit keeps corrupted lengths from allocating arbitrary amounts
+	// of memory (strings and vectors are read in chunks, so they are not limited)
+	if ( numBytes > capacity() )
+	{
+		if ( numBytes > _maxWindowSize )
+			return false;
 
-template <typename T, typename In>
-struct has_n_members<T &, In> : has_n_members<T, In> { };
+		reserve( numBytes );
+	}
 
-template <typename T, typename In>
-struct has_n_members < T &&, In > : has_n_members<T, In> { };
+	while ( size() < numBytes )
+	{
+		auto numRead = _source( _sourceUserData, _writeCursor, capacity() - size() );
+		if ( numRead == 0 )
+			return false;
 
-template <typename T, size_t N>
-constexpr bool has_n_members_v = has_n_members<T, std::make_index_sequence<N>>::value;
+		_writeCursor += numRead;
+	}
+
+	return true;
+}
 
 //---------------------------------------------------------------------------------------------------------------------
-template <typename T>
-SBP_FORCE_INLINE void write_int( buffer &b, T value ) SBP_NOEXCEPT
+SBP_NOINLINE inline void buffer::read_slow( void *data, size_t numBytes ) SBP_NOEXCEPT
 {
-	if constexpr ( sizeof( T ) == 1 )
-	{
-		if ( value >= 0 && value <= 127 )
-			b.write( value );
-		else if ( value < 0 && value >= -32 )
-			b.write( value );
-		else
-			b.write( 0xd0u, value );
-	}
-	else if constexpr ( sizeof( T ) == 2 )
-	{
-		if ( value >= 0 && value <= 127 )
-			b.write( int8_t( value ) );
-		else if ( value < 0 && value >= -32 )
-			b.write( int8_t( value ) );
-		else if ( value <= 127 && value >= -128 )
-			b.write( 0xd0u, int8_t( value ) );
-		else
-			b.write( 0xd1u, value );
-	}
-	else if constexpr ( sizeof( T ) == 4 )
+	auto *output = static_cast<uint8_t *>( data );
+
+	// Copy in chunks, so the window does not have to grow for large values (null output just skips data)
+	while ( numBytes > 0 && _readCursor <= _writeCursor )
 	{
-		if ( value >= 0 && value <= 127 )
-			b.write( int8_t( value ) );
-		else if ( value < 0 && value >= -32 )
-			b.write( int8_t( value ) );
-		else if ( value <= 127 && value >= -128 )
-			b.write( 0xd0u, int8_t( value ) );
-		else if ( value <= 32767 && value >= -32768 )
-			b.write( 0xd1u, int16_t( value ) );
-		else
-			b.write( 0xd2u, value );
+		if ( _readCursor == _writeCursor && !refill( 1 ) )
+			break;
+
+		auto chunkSize = static_cast<size_t>( _writeCursor - _readCursor );
+		if ( chunkSize > numBytes )
+			chunkSize = numBytes;
+
+		if ( output )
+		{
+			memcpy( output, _readCursor, chunkSize );
+			output += chunkSize;
+		}
+
+		_readCursor += chunkSize;
+		numBytes -= chunkSize;
 	}
-	else
+
+	// Move past the end on failure, valid() then reports the error
+	_readCursor += numBytes;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void buffer::ensure_capacity( size_t NumBytes ) SBP_NOEXCEPT
+{
+	if ( _writeCursor + NumBytes > _endCap )
 	{
-		if ( value >= 0 && value <= 127 )
-			b.write( int8_t( value ) );
-		else if ( value < 0 && value >= -32 )
-			b.write( int8_t( value ) );
-		else if ( value <= 127 && value >= -128 )
-			b.write( 0xd0u, int8_t( value ) );
-		else if ( value <= 32767 && value >= -32768 )
-			b.write( 0xd1u, int16_t( value ) );
-		else if ( value <= 2147483647ll && value >= -2147483648ll )
-			b.write( 0xd2u, int32_t( value ) );
-		else
-			b.write( 0xd3u, value );
+		auto cap1 = size() + NumBytes;
+		auto cap2 = capacity() * 3 / 2;
+
+		reserve( ( cap1 > cap2 ) ? cap1 : cap2 );
 	}
 }
 
-//---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE void write( buffer &b, int8_t  value ) SBP_NOEXCEPT { write_int( b, value ); }
-SBP_FORCE_INLINE void write( buffer &b, int16_t value ) SBP_NOEXCEPT { write_int( b, value ); }
-SBP_FORCE_INLINE void write( buffer &b, int32_t value ) SBP_NOEXCEPT { write_int( b, value ); }
-SBP_FORCE_INLINE void write( buffer &b, int64_t value ) SBP_NOEXCEPT { write_int( b, value ); }
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-//---------------------------------------------------------------------------------------------------------------------
-template <typename T>
-SBP_FORCE_INLINE void write_uint( buffer &b, T value ) SBP_NOEXCEPT
+// Writes into pre-allocated memory without any capacity checks, caller is responsible for providing enough space
+class unchecked_writer : detail::adl_base
 {
-	if constexpr ( sizeof( T ) == 1 )
+public:
+	explicit unchecked_writer( uint8_t *cursor ) SBP_NOEXCEPT : _cursor( cursor ) { }
+
+	uint8_t *cursor() const SBP_NOEXCEPT { return _cursor; }
+
+	void write( const void *data, size_t numBytes ) SBP_NOEXCEPT
 	{
-		if ( value <= 127 )
-			b.write( value );
-		else
-			b.write( 0xccu, value );
+		// Empty arrays pass null data, which must not reach memcpy
+		if ( numBytes == 0 )
+			return;
+
+		memcpy( _cursor, data, numBytes );
+		_cursor += numBytes;
 	}
-	else if constexpr ( sizeof( T ) == 2 )
+
+	template <size_t NumBytes> void write( const void *data ) SBP_NOEXCEPT
 	{
-		if ( value <= 127 )
-			b.write( uint8_t( value ) );
-		else if ( value <= 255 )
-			b.write( 0xccu, uint8_t( value ) );
-		else
-			b.write( 0xcdu, value );
+		memcpy( _cursor, data, NumBytes );
+		_cursor += NumBytes;
 	}
-	else if constexpr ( sizeof( T ) == 4 )
+
+	template <typename T> void write( T &&value ) SBP_NOEXCEPT { write<sizeof( T )>( &value ); }
+
+	template <typename T> void write( uint8_t header, T &&value ) SBP_NOEXCEPT
 	{
-		if ( value <= 127 )
-			b.write( uint8_t( value ) );
-		else if ( value <= 255 )
-			b.write( 0xccu, uint8_t( value ) );
-		else if ( value <= 65535 )
-			b.write( 0xcdu, uint16_t( value ) );
-		else
-			b.write( 0xceu, value );
-	}
-	else
-	{
-		if ( value <= 127 )
-			b.write( uint8_t( value ) );
-		else if ( value <= 255 )
-			b.write( 0xccu, uint8_t( value ) );
-		else if ( value <= 65535 )
-			b.write( 0xcdu, uint16_t( value ) );
-		else if ( value <= 4294967295 )
-			b.write( 0xceu, uint32_t( value ) );
-		else
-			b.write( 0xcfu, value );
+		*_cursor++ = header;
+		auto wireValue = detail::wire_order( value );
+		memcpy( _cursor, &wireValue, sizeof( T ) );
+		_cursor += sizeof( T );
 	}
-}
 
-//---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE void write( buffer &b, uint8_t  value ) SBP_NOEXCEPT { write_uint( b, value ); }
-SBP_FORCE_INLINE void write( buffer &b, uint16_t value ) SBP_NOEXCEPT { write_uint( b, value ); }
-SBP_FORCE_INLINE void write( buffer &b, uint32_t value ) SBP_NOEXCEPT { write_uint( b, value ); }
-SBP_FORCE_INLINE void write( buffer &b, uint64_t value ) SBP_NOEXCEPT { write_uint( b, value ); }
+private:
+	uint8_t *_cursor = nullptr;
+};
 
-//---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE void write_str( buffer &b, const char *value, size_t length ) SBP_NOEXCEPT
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Writes into caller-provided memory, never allocates. Once the memory is full, nothing else is written, but size()
+// keeps counting, so it reports total number of bytes required.
+class span_writer : detail::adl_base
 {
-	if ( length <= 31 )
-		b.write( uint8_t( uint8_t( 0b10100000u ) | static_cast<uint8_t>( length ) ) );
-	else if ( length <= 255 )
-		b.write( 0xd9u, uint8_t( length ) );
-	else if ( length <= 65535 )
-		b.write( 0xdau, uint16_t( length ) );
-	else
-		b.write( 0xdbu, uint32_t( length ) );
+public:
+	span_writer( void *data, size_t capacity ) SBP_NOEXCEPT : _data( static_cast<uint8_t *>( data ) ), _capacity( capacity ) { }
 
-	b.write( value, length );
-}
+	uint8_t *data() const SBP_NOEXCEPT { return _data; }
 
-SBP_FORCE_INLINE void write( buffer &b, const char *value ) SBP_NOEXCEPT { write_str( b, value, value ? ( strlen( value ) + 1 ) : 0 ); }
+	size_t size() const SBP_NOEXCEPT { return _size; }
 
-//---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE void write( buffer &b, float value ) SBP_NOEXCEPT { b.write( 0xca, value ); }
-SBP_FORCE_INLINE void write( buffer &b, double value ) SBP_NOEXCEPT { b.write( 0xcb, value ); }
+	size_t capacity() const SBP_NOEXCEPT { return _capacity; }
 
-//---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE void write( buffer &b, bool value ) SBP_NOEXCEPT { b.write( value ? uint8_t( 0xc3u ) : uint8_t( 0xc2u ) ); }
+	error valid() const SBP_NOEXCEPT { return ( _size <= _capacity ) ? error() : error{ error::buffer_full }; }
 
-//---------------------------------------------------------------------------------------------------------------------
-template <typename T>
-SBP_FORCE_INLINE void write_array( buffer &b, const T *values, size_t numValues ) SBP_NOEXCEPT
-{
-	if ( numValues <= 15 )
-		b.write( uint8_t( uint8_t( 0b10010000u ) | static_cast<uint8_t>( numValues ) ) );
-	else if ( numValues <= 65535 )
-		b.write( 0xdcu, uint16_t( numValues ) );
-	else
-		b.write( 0xddu, uint32_t( numValues ) );
+	void reset() SBP_NOEXCEPT { _size = 0; }
 
-	for ( size_t i = 0; i < numValues; ++i )
-		write( b, values[i] );
-}
+	void write( const void *data, size_t numBytes ) SBP_NOEXCEPT
+	{
+		// Nothing to copy, data of empty arrays might be null
+		if ( numBytes == 0 )
+			return;
 
-//---------------------------------------------------------------------------------------------------------------------
-template <size_t NumValues, typename T>
-SBP_FORCE_INLINE void write_array_fixed( buffer &b, const T *values ) SBP_NOEXCEPT
-{
-	if constexpr ( NumValues <= 15 )
-		b.write( uint8_t( uint8_t( 0b10010000u ) | static_cast<uint8_t>( NumValues ) ) );
-	else if constexpr ( NumValues <= 65535 )
-		b.write( 0xdcu, uint16_t( NumValues ) );
-	else
-		b.write( 0xddu, uint32_t( NumValues ) );
+		if ( _size + numBytes <= _capacity )
+			memcpy( _data + _size, data, numBytes );
 
-	for ( size_t i = 0; i < NumValues; ++i )
-		write( b, values[i] );
-}
+		_size += numBytes;
+	}
 
-//---------------------------------------------------------------------------------------------------------------------
-template <typename T, size_t NumValues>
-SBP_FORCE_INLINE void write( buffer &b, const T( &value )[NumValues] ) SBP_NOEXCEPT { write_array( b, value, NumValues ); }
+	template <size_t NumBytes> void write( const void *data ) SBP_NOEXCEPT
+	{
+		if ( _size + NumBytes <= _capacity )
+			memcpy( _data + _size, data, NumBytes );
 
-//---------------------------------------------------------------------------------------------------------------------
-template <typename T>
-SBP_FORCE_INLINE void write_map( buffer &b, const T &value ) SBP_NOEXCEPT
-{
-	auto numValues = value.size();
+		_size += NumBytes;
+	}
 
-	if ( numValues <= 15 )
-		b.write( uint8_t( uint8_t( 0b10000000u ) | static_cast<uint8_t>( numValues ) ) );
-	else if ( numValues <= nl<uint16_t>::max() )
-		b.write( 0xdeu, uint16_t( numValues ) );
-	else
-		b.write( 0xdfu, uint32_t( numValues ) );
+	template <typename T> void write( T &&value ) SBP_NOEXCEPT { write<sizeof( T )>( &value ); }
 
-	for ( const auto & [k, v] : value )
+	template <typename T> void write( uint8_t header, T &&value ) SBP_NOEXCEPT
 	{
-		write( b, k );
-		write( b, v );
+		if ( _size + 1 + sizeof( T ) <= _capacity )
+		{
+			_data[_size] = header;
+			auto wireValue = detail::wire_order( value );
+			memcpy( _data + _size + 1, &wireValue, sizeof( T ) );
+		}
+
+		_size += 1 + sizeof( T );
 	}
-}
 
-//---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE void write_bin( buffer &b, const void *data, size_t numBytes ) SBP_NOEXCEPT
-{
-	if ( numBytes <= 255 )
-		b.write( 0xc4u, uint8_t( numBytes ) );
-	else if ( numBytes <= 65535 )
-		b.write( 0xc5u, uint16_t( numBytes ) );
-	else
-		b.write( 0xc6u, uint32_t( numBytes ) );
+private:
+	uint8_t *_data = nullptr;
+	size_t _size = 0;
+	size_t _capacity = 0;
+};
 
-	b.write( data, numBytes );
-}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-//---------------------------------------------------------------------------------------------------------------------
-template <size_t NumBytes>
-SBP_FORCE_INLINE void write_ext( buffer &b, int8_t type, const void *data ) SBP_NOEXCEPT
+// Writes into fixed-size window, which is passed to flush callback whenever it gets full, so memory usage stays bounded
+// no matter how large the output is. Data larger than the window bypass it and go directly to the callback.
+class stream_writer : detail::adl_base
 {
-	if constexpr ( NumBytes == 1 )
-		b.write( 0xd4u, type );
-	else if constexpr ( NumBytes == 2 )
-		b.write( 0xd5u, type );
-	else if constexpr ( NumBytes == 4 )
-		b.write( 0xd6u, type );
-	else if constexpr ( NumBytes == 8 )
-		b.write( 0xd7u, type );
-	else if constexpr ( NumBytes == 16 )
-		b.write( 0xd8u, type );
-	else if constexpr ( NumBytes <= 255 )
-	{
-		b.write( 0xc7u, uint8_t( NumBytes ) );
-		b.write( type );
-	}
-	else if constexpr ( NumBytes <= 65535 )
-	{
-		b.write( 0xc8u, uint16_t( NumBytes ) );
-		b.write( type );
-	}
-	else
-	{
-		b.write( 0xc9u, uint32_t( NumBytes ) );
-		b.write( type );
-	}
+public:
+	// Must consume all numBytes, returns false on failure
+	using flush_callback = bool ( * )( void *userData, const void *data, size_t numBytes );
 
-	b.write( data, NumBytes );
-}
+	static constexpr size_t default_window_size = 1024 * 1024;
 
-//---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE void write_ext( buffer &b, int8_t type, const void *data, size_t numBytes ) SBP_NOEXCEPT
-{
-	if ( numBytes == 1 )
-		b.write( 0xd4u, type );
-	else if ( numBytes == 2 )
-		b.write( 0xd5u, type );
-	else if ( numBytes == 4 )
-		b.write( 0xd6u, type );
-	else if ( numBytes == 8 )
-		b.write( 0xd7u, type );
-	else if ( numBytes == 16 )
-		b.write( 0xd8u, type );
-	else if ( numBytes <= 255 )
-	{
-		b.write( 0xc7u, uint8_t( numBytes ) );
-		b.write( type );
-	}
-	else if ( numBytes <= 65535 )
-	{
-		b.write( 0xc8u, uint16_t( numBytes ) );
-		b.write( type );
-	}
-	else
-	{
-		b.write( 0xc9u, uint32_t( numBytes ) );
-		b.write( type );
-	}
+	stream_writer( flush_callback callback, void *userData, size_t windowSize = default_window_size ) SBP_NOEXCEPT;
 
-	b.write( data, numBytes );
-}
+	stream_writer( const stream_writer & ) = delete;
 
-//---------------------------------------------------------------------------------------------------------------------
-template <typename T, typename... Tail>
-void write_multiple( buffer &b, const T &value, const Tail &... tail ) SBP_NOEXCEPT
-{
-	if constexpr ( std::is_enum_v<T> )
-		write( b, std::underlying_type_t<T>( value ) );
-	else
-		write( b, value );
+	// Remaining data should be flushed explicitly to get the result, this is just a safety net
+	~stream_writer() { flush(); delete[] _window; }
 
-	if constexpr ( sizeof...( Tail ) > 0 )
-		write_multiple( b, tail... );
-}
+	stream_writer &operator=( const stream_writer & ) = delete;
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Total number of bytes written (flushed or not)
+	size_t size() const SBP_NOEXCEPT { return _flushedSize + static_cast<size_t>( _cursor - _window ); }
 
-//---------------------------------------------------------------------------------------------------------------------
-template <typename T>
-SBP_FORCE_INLINE error read_int( buffer &b, T &value ) SBP_NOEXCEPT
-{
-	if ( auto header = b.read<uint8_t>(); ( header & 0b10000000u ) == 0 )
-	{
-		value = static_cast<T>( header );
-		return b.valid();
-	}
-	else if ( ( header & 0b11100000u ) == 0b11100000u )
+	error valid() const SBP_NOEXCEPT { return _failed ? error{ error::io_error } : error(); }
+
+	error flush() SBP_NOEXCEPT;
+
+	void write( const void *data, size_t numBytes ) SBP_NOEXCEPT
 	{
-		value = static_cast<T>( static_cast<int8_t>( header ) );
-		return b.valid();
-	}
-	else if ( header == 0xd0u )
-		return b.read<int8_t>( value );
-	else if ( header == 0xd1u )
-		return b.read<int16_t>( value );
-	else if ( header == 0xd2u )
-		return b.read<int32_t>( value );
-	else if ( header == 0xd3u )
-		return b.read<int64_t>( value );
+		// Nothing to copy, data of empty arrays might be null
+		if ( numBytes == 0 )
+			return;
 
-	return { error::corrupted_data };
-}
+		if ( _cursor + numBytes > _end )
+			return write_slow( data, numBytes );
 
-//---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE error read( buffer &b, int8_t  &value ) SBP_NOEXCEPT { return read_int( b, value ); }
-SBP_FORCE_INLINE error read( buffer &b, int16_t &value ) SBP_NOEXCEPT { return read_int( b, value ); }
-SBP_FORCE_INLINE error read( buffer &b, int32_t &value ) SBP_NOEXCEPT { return read_int( b, value ); }
-SBP_FORCE_INLINE error read( buffer &b, int64_t &value ) SBP_NOEXCEPT { return read_int( b, value ); }
+		memcpy( _cursor, data, numBytes );
+		_cursor += numBytes;
+	}
 
-//---------------------------------------------------------------------------------------------------------------------
-template <typename T>
-SBP_FORCE_INLINE error read_uint( buffer &b, T &value ) SBP_NOEXCEPT
-{
-	if ( auto header = b.read<uint8_t>(); ( header & 0b10000000u ) == 0 )
+	template <size_t NumBytes> void write( const void *data ) SBP_NOEXCEPT
 	{
-		value = header;
-		return b.valid();
-	}
-	else if ( header == 0xccu )
-		return b.read<uint8_t>( value );
-	else if ( header == 0xcdu )
-		return b.read<uint16_t>( value );
-	else if ( header == 0xceu )
-		return b.read<uint32_t>( value );
-	else if ( header == 0xcfu )
-		return b.read<uint64_t>( value );
+		if ( _cursor + NumBytes > _end )
+			flush();
 
-	return { error::corrupted_data };
-}
+		memcpy( _cursor, data, NumBytes );
+		_cursor += NumBytes;
+	}
 
-//---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE error read( buffer &b, uint8_t  &value ) SBP_NOEXCEPT { return read_uint( b, value ); }
-SBP_FORCE_INLINE error read( buffer &b, uint16_t &value ) SBP_NOEXCEPT { return read_uint( b, value ); }
-SBP_FORCE_INLINE error read( buffer &b, uint32_t &value ) SBP_NOEXCEPT { return read_uint( b, value ); }
-SBP_FORCE_INLINE error read( buffer &b, uint64_t &value ) SBP_NOEXCEPT { return read_uint( b, value ); }
+	template <typename T> void write( T &&value ) SBP_NOEXCEPT { write<sizeof( T )>( &value ); }
 
-//---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE error read_string_length( buffer &b, size_t &value ) SBP_NOEXCEPT
-{
-	if ( auto header = b.read<uint8_t>(); ( header & 0b11100000u ) == 0b10100000u )
+	template <typename T> void write( uint8_t header, T &&value ) SBP_NOEXCEPT
 	{
-		value = header & 0b00011111u;
-		return b.valid();
+		if ( _cursor + 1 + sizeof( T ) > _end )
+			flush();
+
+		*_cursor++ = header;
+		auto wireValue = detail::wire_order( value );
+		memcpy( _cursor, &wireValue, sizeof( T ) );
+		_cursor += sizeof( T );
 	}
-	else if ( header == 0xd9u )
-		return b.read<uint8_t>( value );
-	else if ( header == 0xdau )
-		return b.read<uint16_t>( value );
-	else if ( header == 0xdbu )
-		return b.read<uint32_t>( value );
 
-	return { error::corrupted_data };
-}
+private:
+	// Smallest window, which still fits any header with its value
+	static constexpr size_t min_window_size = 64;
 
-//---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE error read( buffer &b, const char *&value ) SBP_NOEXCEPT
-{
-	size_t length = 0;
-	if ( auto err = read_string_length( b, length ) )
-		return err;
+	void write_slow( const void *data, size_t numBytes ) SBP_NOEXCEPT;
 
-	value = reinterpret_cast<const char *>( b.seek( b.tell() + length ) );
-	return b.valid();
-}
+	flush_callback _callback = nullptr;
+	void *_userData = nullptr;
 
-//---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE error read( buffer &b, float &value ) SBP_NOEXCEPT
-{
-	if ( b.read<uint8_t>() != 0xcau )
-		return { error::corrupted_data };
+	uint8_t *_window = nullptr;
+	uint8_t *_cursor = nullptr;
+	const uint8_t *_end = nullptr;
 
-	return b.read<float>( value );
-}
+	size_t _flushedSize = 0;
+	bool _failed = false;
+};
 
 //---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE error read( buffer &b, double &value ) SBP_NOEXCEPT
+inline stream_writer::stream_writer( flush_callback callback, void *userData, size_t windowSize ) SBP_NOEXCEPT
+	: _callback( callback )
+	, _userData( userData )
 {
-	if ( b.read<uint8_t>() != 0xcbu )
-		return { error::corrupted_data };
+	if ( windowSize < min_window_size )
+		windowSize = min_window_size;
 
-	return b.read<double>( value );
+	_window = _cursor = new uint8_t[windowSize];
+	_end = _window + windowSize;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE error read( buffer &b, bool &value ) SBP_NOEXCEPT
+inline error stream_writer::flush() SBP_NOEXCEPT
 {
-	if ( auto header = b.read<uint8_t>(); header == 0xc2u || header == 0xc3u )
+	if ( auto numBytes = static_cast<size_t>( _cursor - _window ); numBytes > 0 )
 	{
-		value = ( header == 0xc3u );
-		return { error::none };
+		if ( !_failed && !_callback( _userData, _window, numBytes ) )
+			_failed = true;
+
+		_flushedSize += numBytes;
+		_cursor = _window;
 	}
 
-	return { error::corrupted_data };
+	return valid();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE error read_array_length( buffer &b, size_t &value ) SBP_NOEXCEPT
+inline void stream_writer::write_slow( const void *data, size_t numBytes ) SBP_NOEXCEPT
 {
-	if ( auto header = b.read<uint8_t>(); ( header & 0b11110000u ) == 0b10010000u )
+	flush();
+
+	if ( _window + numBytes <= _end )
 	{
-		value = header & 0b00001111u;
-		return { error::none };
+		memcpy( _cursor, data, numBytes );
+		_cursor += numBytes;
 	}
-	else if ( header == 0xdcu )
-		return b.read<uint16_t>( value );
-	else if ( header == 0xddu )
-		return b.read<uint32_t>( value );
+	else
+	{
+		if ( !_failed && !_callback( _userData, data, numBytes ) )
+			_failed = true;
 
-	return { error::corrupted_data };
+		_flushedSize += numBytes;
+	}
 }
 
-//---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE error read_map_length( buffer &b, size_t &value ) SBP_NOEXCEPT
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Buffer pulling data from source callback into fixed-size window whenever the read cursor reaches its end. Only values
+// viewed directly in the window (const char *, std::string_view, packed_view...), packed std::array and packed columns
+// of column_vector larger than the whole window make it grow, up to maxWindowSize, longer ones fail to read. Pointers
+// into buffer memory are only valid until the next read, prefer owning types (std::string, std::vector...), which are
+// read in chunks and never limited.
+class stream_reader : public buffer
 {
-	if ( auto header = b.read<uint8_t>(); ( header & 0b11110000u ) == 0b10000000u )
+public:
+	static constexpr size_t default_window_size = 1024 * 1024;
+
+	static constexpr size_t default_max_window_size = 64 * 1024 * 1024;
+
+	stream_reader( source_callback callback, void *userData, size_t windowSize = default_window_size,
+	               size_t maxWindowSize = default_max_window_size ) SBP_NOEXCEPT
 	{
-		value = header & 0b00001111u;
-		return { error::none };
+		reserve( windowSize );
+		_source = callback;
+		_sourceUserData = userData;
+		_maxWindowSize = ( maxWindowSize > windowSize ) ? maxWindowSize : windowSize;
 	}
-	else if ( header == 0xdeu )
-		return b.read<uint16_t>( value );
-	else if ( header == 0xdfu )
-		return b.read<uint32_t>( value );
+};
 
-	return { error::corrupted_data };
-}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-//---------------------------------------------------------------------------------------------------------------------
-template <typename T, typename KeyType, typename ValueType>
-SBP_FORCE_INLINE error read_map( buffer &b, T &value ) SBP_NOEXCEPT
+// Zero-copy view of a packed array (single bin/ext blob), points directly into the buffer memory (data may be unaligned).
+// Data are kept in wire byte order, use at() to get host byte order values when SBP_BIG_ENDIAN is defined.
+template <typename T>
+struct packed_view final
 {
-	size_t numValues = 0;
-	if ( auto err = read_map_length( b, numValues ) )
-		return err;
+	static_assert( detail::is_packable_v<T>, "packed_view<T> requires arithmetic or trivially copyable SBP_EXTENSION type" );
 
-	value.clear();
-	for ( size_t i = 0; i < numValues; ++i )
+	const T *data = nullptr;
+	size_t size = 0;
+
+	// Yields values by at(), data might be unaligned, so they must not be accessed through T pointers directly
+	struct iterator final
 	{
-		KeyType k;
-		if ( auto err = read( b, k ) )
-			return err;
+		const packed_view *view;
+		size_t index;
 
-		ValueType v;
-		if ( auto err = read( b, v ) )
-			return err;
+		T operator*() const SBP_NOEXCEPT { return view->at( index ); }
+		iterator &operator++() SBP_NOEXCEPT { ++index; return *this; }
+		bool operator==( const iterator &other ) const SBP_NOEXCEPT { return index == other.index; }
+		bool operator!=( const iterator &other ) const SBP_NOEXCEPT { return index != other.index; }
+	};
+
+	iterator begin() const SBP_NOEXCEPT { return { this, 0 }; }
+	iterator end() const SBP_NOEXCEPT { return { this, size }; }
+
+	T at( size_t index ) const SBP_NOEXCEPT
+	{
+		T value;
+		memcpy( &value, data + index, sizeof( T ) );
 
-		value[std::move( k )] = std::move( v );
+		if constexpr ( std::is_arithmetic_v<T> )
+			return detail::wire_order( value );
+		else
+			return value;
 	}
+};
 
-	return b.valid();
+} // namespace sbp
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace sbp::detail {
+
+template <size_t>
+struct any { template <typename T> operator T() const; };
+
+template <typename T, typename In, typename = void>
+struct has_n_members : std::false_type { };
+
+template <typename T, size_t... In>
+struct has_n_members < T, std::index_sequence<In...>, std::void_t < decltype( T { any<In>()... } ) >> :
+std::true_type { };
+
+template <typename T, typename In>
+struct has_n_members<T &, In> : has_n_members<T, In> { };
+
+template <typename T, typename In>
+struct has_n_members < T &&, In > : has_n_members<T, In> { };
+
+template <typename T, size_t N>
+constexpr bool has_n_members_v = has_n_members<T, std::make_index_sequence<N>>::value;
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename F>
+SBP_FORCE_INLINE decltype( auto ) apply_members( T &msg, F &&func ) SBP_NOEXCEPT
+{
+	using Type = std::remove_cv_t<T>;
+
+	if constexpr ( has_n_members_v<Type, 10> )
+	{
+		auto &[m0, m1, m2, m3, m4, m5, m6, m7, m8, m9] = msg;
+		return func( m0, m1, m2, m3, m4, m5, m6, m7, m8, m9 );
+	}
+	else if constexpr ( has_n_members_v<Type, 9> )
+	{
+		auto &[m0, m1, m2, m3, m4, m5, m6, m7, m8] = msg;
+		return func( m0, m1, m2, m3, m4, m5, m6, m7, m8 );
+	}
+	else if constexpr ( has_n_members_v<Type, 8> )
+	{
+		auto &[m0, m1, m2, m3, m4, m5, m6, m7] = msg;
+		return func( m0, m1, m2, m3, m4, m5, m6, m7 );
+	}
+	else if constexpr ( has_n_members_v<Type, 7> )
+	{
+		auto &[m0, m1, m2, m3, m4, m5, m6] = msg;
+		return func( m0, m1, m2, m3, m4, m5, m6 );
+	}
+	else if constexpr ( has_n_members_v<Type, 6> )
+	{
+		auto &[m0, m1, m2, m3, m4, m5] = msg;
+		return func( m0, m1, m2, m3, m4, m5 );
+	}
+	else if constexpr ( has_n_members_v<Type, 5> )
+	{
+		auto &[m0, m1, m2, m3, m4] = msg;
+		return func( m0, m1, m2, m3, m4 );
+	}
+	else if constexpr ( has_n_members_v<Type, 4> )
+	{
+		auto &[m0, m1, m2, m3] = msg;
+		return func( m0, m1, m2, m3 );
+	}
+	else if constexpr ( has_n_members_v<Type, 3> )
+	{
+		auto &[m0, m1, m2] = msg;
+		return func( m0, m1, m2 );
+	}
+	else if constexpr ( has_n_members_v<Type, 2> )
+	{
+		auto &[m0, m1] = msg;
+		return func( m0, m1 );
+	}
+	else if constexpr ( has_n_members_v<Type, 1> )
+	{
+		auto &[m0] = msg;
+		return func( m0 );
+	}
+	else
+		return func();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-template <size_t NumBytes, int8_t TypeID = 0>
-SBP_FORCE_INLINE error read_ext( buffer &b, const void *&value ) SBP_NOEXCEPT
+template <typename Buffer, typename T>
+SBP_FORCE_INLINE void write_int( Buffer &b, T value ) SBP_NOEXCEPT
 {
-	auto header = b.read<uint8_t>();
-	if constexpr ( NumBytes == 1 )
+	if constexpr ( sizeof( T ) == 1 )
 	{
-		if ( header != 0xd4u )
-			return { error::corrupted_data };
+		if ( value >= 0 && value <= 127 )
+			b.write( value );
+		else if ( value < 0 && value >= -32 )
+			b.write( value );
+		else
+			b.write( 0xd0u, value );
 	}
-	else if constexpr ( NumBytes == 2 )
+	else if constexpr ( sizeof( T ) == 2 )
 	{
-		if ( header != 0xd5u )
-			return { error::corrupted_data };
+		if ( value >= 0 && value <= 127 )
+			b.write( int8_t( value ) );
+		else if ( value < 0 && value >= -32 )
+			b.write( int8_t( value ) );
+		else if ( value <= 127 && value >= -128 )
+			b.write( 0xd0u, int8_t( value ) );
+		else
+			b.write( 0xd1u, value );
 	}
-	else if constexpr ( NumBytes == 4 )
+	else if constexpr ( sizeof( T ) == 4 )
 	{
-		if ( header != 0xd6u )
-			return { error::corrupted_data };
+		if ( value >= 0 && value <= 127 )
+			b.write( int8_t( value ) );
+		else if ( value < 0 && value >= -32 )
+			b.write( int8_t( value ) );
+		else if ( value <= 127 && value >= -128 )
+			b.write( 0xd0u, int8_t( value ) );
+		else if ( value <= 32767 && value >= -32768 )
+			b.write( 0xd1u, int16_t( value ) );
+		else
+			b.write( 0xd2u, value );
 	}
-	else if constexpr ( NumBytes == 8 )
+	else
 	{
-		if ( header != 0xd7u )
-			return { error::corrupted_data };
+		if ( value >= 0 && value <= 127 )
+			b.write( int8_t( value ) );
+		else if ( value < 0 && value >= -32 )
+			b.write( int8_t( value ) );
+		else if ( value <= 127 && value >= -128 )
+			b.write( 0xd0u, int8_t( value ) );
+		else if ( value <= 32767 && value >= -32768 )
+			b.write( 0xd1u, int16_t( value ) );
+		else if ( value <= 2147483647ll && value >= -2147483648ll )
+			b.write( 0xd2u, int32_t( value ) );
+		else
+			b.write( 0xd3u, value );
 	}
-	else if constexpr ( NumBytes == 16 )
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer>
+SBP_FORCE_INLINE void write( Buffer &b, int8_t  value ) SBP_NOEXCEPT { write_int( b, value ); }
+template <typename Buffer>
+SBP_FORCE_INLINE void write( Buffer &b, int16_t value ) SBP_NOEXCEPT { write_int( b, value ); }
+template <typename Buffer>
+SBP_FORCE_INLINE void write( Buffer &b, int32_t value ) SBP_NOEXCEPT { write_int( b, value ); }
+template <typename Buffer>
+SBP_FORCE_INLINE void write( Buffer &b, int64_t value ) SBP_NOEXCEPT { write_int( b, value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename T>
+SBP_FORCE_INLINE void write_uint( Buffer &b, T value ) SBP_NOEXCEPT
+{
+	if constexpr ( sizeof( T ) == 1 )
 	{
-		if ( header != 0xd8u )
-			return { error::corrupted_data };
+		if ( value <= 127 )
+			b.write( value );
+		else
+			b.write( 0xccu, value );
 	}
-	else if constexpr ( NumBytes <= 255 )
+	else if constexpr ( sizeof( T ) == 2 )
 	{
-		if ( header != 0xc7u || b.read<uint8_t>() != NumBytes )
-			return { error::corrupted_data };
+		if ( value <= 127 )
+			b.write( uint8_t( value ) );
+		else if ( value <= 255 )
+			b.write( 0xccu, uint8_t( value ) );
+		else
+			b.write( 0xcdu, value );
 	}
-	else if constexpr ( NumBytes <= 65535 )
+	else if constexpr ( sizeof( T ) == 4 )
 	{
-		if ( header != 0xc8u || b.read<uint16_t>() != NumBytes )
-			return { error::corrupted_data };
+		if ( value <= 127 )
+			b.write( uint8_t( value ) );
+		else if ( value <= 255 )
+			b.write( 0xccu, uint8_t( value ) );
+		else if ( value <= 65535 )
+			b.write( 0xcdu, uint16_t( value ) );
+		else
+			b.write( 0xceu, value );
 	}
 	else
 	{
-		if ( header != 0xc9u || b.read<uint32_t>() != NumBytes )
-			return { error::corrupted_data };
+		if ( value <= 127 )
+			b.write( uint8_t( value ) );
+		else if ( value <= 255 )
+			b.write( 0xccu, uint8_t( value ) );
+		else if ( value <= 65535 )
+			b.write( 0xcdu, uint16_t( value ) );
+		else if ( value <= 4294967295 )
+			b.write( 0xceu, uint32_t( value ) );
+		else
+			b.write( 0xcfu, value );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer>
+SBP_FORCE_INLINE void write( Buffer &b, uint8_t  value ) SBP_NOEXCEPT { write_uint( b, value ); }
+template <typename Buffer>
+SBP_FORCE_INLINE void write( Buffer &b, uint16_t value ) SBP_NOEXCEPT { write_uint( b, value ); }
+template <typename Buffer>
+SBP_FORCE_INLINE void write( Buffer &b, uint32_t value ) SBP_NOEXCEPT { write_uint( b, value ); }
+template <typename Buffer>
+SBP_FORCE_INLINE void write( Buffer &b, uint64_t value ) SBP_NOEXCEPT { write_uint( b, value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer>
+SBP_FORCE_INLINE void write_str( Buffer &b, const char *value, size_t length ) SBP_NOEXCEPT
+{
+	if ( length <= 31 )
+		b.write( uint8_t( uint8_t( 0b10100000u ) | static_cast<uint8_t>( length ) ) );
+	else if ( length <= 255 )
+		b.write( 0xd9u, uint8_t( length ) );
+	else if ( length <= 65535 )
+		b.write( 0xdau, uint16_t( length ) );
+	else
+		b.write( 0xdbu, uint32_t( length ) );
+
+	b.write( value, length );
+}
+
+template <typename Buffer>
+SBP_FORCE_INLINE void write( Buffer &b, const char *value ) SBP_NOEXCEPT { write_str( b, value, value ? ( strlen( value ) + 1 ) : 0 ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer>
+SBP_FORCE_INLINE void write( Buffer &b, float value ) SBP_NOEXCEPT { b.write( 0xca, value ); }
+template <typename Buffer>
+SBP_FORCE_INLINE void write( Buffer &b, double value ) SBP_NOEXCEPT { b.write( 0xcb, value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer>
+SBP_FORCE_INLINE void write( Buffer &b, bool value ) SBP_NOEXCEPT { b.write( value ? uint8_t( 0xc3u ) : uint8_t( 0xc2u ) ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer>
+SBP_FORCE_INLINE void write_array_header( Buffer &b, size_t numValues ) SBP_NOEXCEPT
+{
+	if ( numValues <= 15 )
+		b.write( uint8_t( uint8_t( 0b10010000u ) | static_cast<uint8_t>( numValues ) ) );
+	else if ( numValues <= 65535 )
+		b.write( 0xdcu, uint16_t( numValues ) );
+	else
+		b.write( 0xddu, uint32_t( numValues ) );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename T>
+SBP_FORCE_INLINE void write_array( Buffer &b, const T *values, size_t numValues ) SBP_NOEXCEPT
+{
+	write_array_header( b, numValues );
+
+	for ( size_t i = 0; i < numValues; ++i )
+		write( b, values[i] );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <size_t NumValues, typename Buffer, typename T>
+SBP_FORCE_INLINE void write_array_fixed( Buffer &b, const T *values ) SBP_NOEXCEPT
+{
+	if constexpr ( NumValues <= 15 )
+		b.write( uint8_t( uint8_t( 0b10010000u ) | static_cast<uint8_t>( NumValues ) ) );
+	else if constexpr ( NumValues <= 65535 )
+		b.write( 0xdcu, uint16_t( NumValues ) );
+	else
+		b.write( 0xddu, uint32_t( NumValues ) );
+
+	for ( size_t i = 0; i < NumValues; ++i )
+		write( b, values[i] );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename T, size_t NumValues>
+SBP_FORCE_INLINE void write( Buffer &b, const T( &value )[NumValues] ) SBP_NOEXCEPT { write_array( b, value, NumValues ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename T>
+SBP_FORCE_INLINE void write_map( Buffer &b, const T &value ) SBP_NOEXCEPT
+{
+	auto numValues = value.size();
+
+	if ( numValues <= 15 )
+		b.write( uint8_t( uint8_t( 0b10000000u ) | static_cast<uint8_t>( numValues ) ) );
+	else if ( numValues <= 65535 )
+		b.write( 0xdeu, uint16_t( numValues ) );
+	else
+		b.write( 0xdfu, uint32_t( numValues ) );
+
+	for ( const auto & [k, v] : value )
+	{
+		write( b, k );
+		write( b, v );
 	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer>
+SBP_FORCE_INLINE void write_bin_header( Buffer &b, size_t numBytes ) SBP_NOEXCEPT
+{
+	if ( numBytes <= 255 )
+		b.write( 0xc4u, uint8_t( numBytes ) );
+	else if ( numBytes <= 65535 )
+		b.write( 0xc5u, uint16_t( numBytes ) );
+	else
+		b.write( 0xc6u, uint32_t( numBytes ) );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer>
+SBP_FORCE_INLINE void write_bin( Buffer &b, const void *data, size_t numBytes ) SBP_NOEXCEPT
+{
+	write_bin_header( b, numBytes );
+	b.write( data, numBytes );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <size_t NumBytes, typename Buffer>
+SBP_FORCE_INLINE void write_ext( Buffer &b, int8_t type, const void *data ) SBP_NOEXCEPT
+{
+	if constexpr ( NumBytes == 1 )
+		b.write( 0xd4u, type );
+	else if constexpr ( NumBytes == 2 )
+		b.write( 0xd5u, type );
+	else if constexpr ( NumBytes == 4 )
+		b.write( 0xd6u, type );
+	else if constexpr ( NumBytes == 8 )
+		b.write( 0xd7u, type );
+	else if constexpr ( NumBytes == 16 )
+		b.write( 0xd8u, type );
+	else if constexpr ( NumBytes <= 255 )
+	{
+		b.write( 0xc7u, uint8_t( NumBytes ) );
+		b.write( type );
+	}
+	else if constexpr ( NumBytes <= 65535 )
+	{
+		b.write( 0xc8u, uint16_t( NumBytes ) );
+		b.write( type );
+	}
+	else
+	{
+		b.write( 0xc9u, uint32_t( NumBytes ) );
+		b.write( type );
+	}
+
+	b.write( data, NumBytes );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer>
+SBP_FORCE_INLINE void write_ext_header( Buffer &b, int8_t type, size_t numBytes ) SBP_NOEXCEPT
+{
+	if ( numBytes == 1 )
+		b.write( 0xd4u, type );
+	else if ( numBytes == 2 )
+		b.write( 0xd5u, type );
+	else if ( numBytes == 4 )
+		b.write( 0xd6u, type );
+	else if ( numBytes == 8 )
+		b.write( 0xd7u, type );
+	else if ( numBytes == 16 )
+		b.write( 0xd8u, type );
+	else if ( numBytes <= 255 )
+	{
+		b.write( 0xc7u, uint8_t( numBytes ) );
+		b.write( type );
+	}
+	else if ( numBytes <= 65535 )
+	{
+		b.write( 0xc8u, uint16_t( numBytes ) );
+		b.write( type );
+	}
+	else
+	{
+		b.write( 0xc9u, uint32_t( numBytes ) );
+		b.write( type );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer>
+SBP_FORCE_INLINE void write_ext( Buffer &b, int8_t type, const void *data, size_t numBytes ) SBP_NOEXCEPT
+{
+	write_ext_header( b, type, numBytes );
+	b.write( data, numBytes );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename T>
+SBP_FORCE_INLINE void write_packed_header( Buffer &b, size_t numValues ) SBP_NOEXCEPT
+{
+	static_assert( is_packable_v<T>, "write_packed requires arithmetic or trivially copyable SBP_EXTENSION type" );
+
+	if constexpr ( is_extension_v<T> )
+		write_ext_header( b, extension<T>::type_id, numValues * sizeof( T ) );
+	else
+		write_bin_header( b, numValues * sizeof( T ) );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename T>
+SBP_FORCE_INLINE void write_packed( Buffer &b, const T *values, size_t numValues ) SBP_NOEXCEPT
+{
+	write_packed_header<Buffer, T>( b, numValues );
+
+	if constexpr ( swap_wire_order && std::is_arithmetic_v<T> && sizeof( T ) > 1 && std::is_base_of_v<buffer, Buffer> )
+	{
+		uint8_t *output = b.prepare_write( numValues * sizeof( T ) );
+		copy_swapped<sizeof( T )>( output, values, numValues );
+		b.commit_write( output + numValues * sizeof( T ) );
+	}
+	else if constexpr ( swap_wire_order && std::is_arithmetic_v<T> && sizeof( T ) > 1 )
+	{
+		// Other writers get data swapped in chunks small enough to stay in L1 cache
+		constexpr size_t chunkSize = 4096 / sizeof( T );
+		T chunk[chunkSize];
+
+		for ( size_t i = 0; i < numValues; i += chunkSize )
+		{
+			size_t numChunkValues = ( numValues - i < chunkSize ) ? ( numValues - i ) : chunkSize;
+			copy_wire_order( chunk, values + i, numChunkValues );
+			b.write( chunk, numChunkValues * sizeof( T ) );
+		}
+	}
+	else if ( numValues > 0 )
+		b.write( values, numValues * sizeof( T ) );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// View data are in wire byte order already
+template <typename Buffer, typename T>
+SBP_FORCE_INLINE void write( Buffer &b, const packed_view<T> &value ) SBP_NOEXCEPT
+{
+	write_packed_header<Buffer, T>( b, value.size );
+	b.write( value.data, value.size * sizeof( T ) );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename T, typename... Tail>
+void write_multiple( Buffer &b, const T &value, const Tail &... tail ) SBP_NOEXCEPT
+{
+	if constexpr ( std::is_enum_v<T> )
+		write( b, std::underlying_type_t<T>( value ) );
+	else
+		write( b, value );
+
+	if constexpr ( sizeof...( Tail ) > 0 )
+		write_multiple( b, tail... );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Tag argument of all packed_size overloads (ADL, see adl_base)
+struct size_tag : adl_base { };
+
+//---------------------------------------------------------------------------------------------------------------------
+constexpr size_t str_header_size( size_t length ) SBP_NOEXCEPT { return ( length <= 31 ) ? 1 : ( length <= 255 ) ? 2 : ( length <= 65535 ) ? 3 : 5; }
+constexpr size_t array_header_size( size_t numValues ) SBP_NOEXCEPT { return ( numValues <= 15 ) ? 1 : ( numValues <= 65535 ) ? 3 : 5; }
+constexpr size_t map_header_size( size_t numValues ) SBP_NOEXCEPT { return ( numValues <= 15 ) ? 1 : ( numValues <= 65535 ) ? 3 : 5; }
+constexpr size_t bin_header_size( size_t numBytes ) SBP_NOEXCEPT { return ( numBytes <= 255 ) ? 2 : ( numBytes <= 65535 ) ? 3 : 5; }
+
+constexpr size_t ext_header_size( size_t numBytes ) SBP_NOEXCEPT
+{
+	if ( numBytes == 1 || numBytes == 2 || numBytes == 4 || numBytes == 8 || numBytes == 16 )
+		return 2;
+
+	return ( numBytes <= 255 ) ? 3 : ( numBytes <= 65535 ) ? 4 : 6;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+constexpr size_t int_size( T value ) SBP_NOEXCEPT
+{
+	if ( value <= 127 && value >= -32 )
+		return 1;
+	else if ( value <= 127 && value >= -128 )
+		return 2;
+	else if ( value <= 32767 && value >= -32768 )
+		return 3;
+	else if ( value <= 2147483647ll && value >= -2147483648ll )
+		return 5;
+
+	return 9;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+constexpr size_t uint_size( T value ) SBP_NOEXCEPT
+{
+	if ( value <= 127 )
+		return 1;
+	else if ( value <= 255 )
+		return 2;
+	else if ( value <= 65535 )
+		return 3;
+	else if ( value <= 4294967295 )
+		return 5;
+
+	return 9;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE size_t packed_size( size_tag, int8_t  value ) SBP_NOEXCEPT { return int_size( value ); }
+SBP_FORCE_INLINE size_t packed_size( size_tag, int16_t value ) SBP_NOEXCEPT { return int_size( value ); }
+SBP_FORCE_INLINE size_t packed_size( size_tag, int32_t value ) SBP_NOEXCEPT { return int_size( value ); }
+SBP_FORCE_INLINE size_t packed_size( size_tag, int64_t value ) SBP_NOEXCEPT { return int_size( value ); }
+
+SBP_FORCE_INLINE size_t packed_size( size_tag, uint8_t  value ) SBP_NOEXCEPT { return uint_size( value ); }
+SBP_FORCE_INLINE size_t packed_size( size_tag, uint16_t value ) SBP_NOEXCEPT { return uint_size( value ); }
+SBP_FORCE_INLINE size_t packed_size( size_tag, uint32_t value ) SBP_NOEXCEPT { return uint_size( value ); }
+SBP_FORCE_INLINE size_t packed_size( size_tag, uint64_t value ) SBP_NOEXCEPT { return uint_size( value ); }
+
+SBP_FORCE_INLINE size_t packed_size( size_tag, float ) SBP_NOEXCEPT { return 1 + sizeof( float ); }
+SBP_FORCE_INLINE size_t packed_size( size_tag, double ) SBP_NOEXCEPT { return 1 + sizeof( double ); }
+SBP_FORCE_INLINE size_t packed_size( size_tag, bool ) SBP_NOEXCEPT { return 1; }
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE size_t packed_size( size_tag, const char *value ) SBP_NOEXCEPT
+{
+	size_t length = value ? ( strlen( value ) + 1 ) : 0;
+	return str_header_size( length ) + length;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+constexpr size_t packed_size_packed( size_t numValues ) SBP_NOEXCEPT
+{
+	auto numBytes = numValues * sizeof( T );
+
+	if constexpr ( is_extension_v<T> )
+		return ext_header_size( numBytes ) + numBytes;
+	else
+		return bin_header_size( numBytes ) + numBytes;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+SBP_FORCE_INLINE size_t packed_size_array( const T *values, size_t numValues ) SBP_NOEXCEPT
+{
+	auto result = array_header_size( numValues );
+
+	for ( size_t i = 0; i < numValues; ++i )
+		result += packed_size( size_tag(), values[i] );
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+SBP_FORCE_INLINE size_t packed_size_map( const T &value ) SBP_NOEXCEPT
+{
+	auto result = map_header_size( value.size() );
+
+	for ( const auto & [k, v] : value )
+		result += packed_size( size_tag(), k ) + packed_size( size_tag(), v );
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, size_t NumValues>
+SBP_FORCE_INLINE size_t packed_size( size_tag, const T( &value )[NumValues] ) SBP_NOEXCEPT { return packed_size_array( value, NumValues ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+SBP_FORCE_INLINE size_t packed_size( size_tag, const packed_view<T> &value ) SBP_NOEXCEPT { return packed_size_packed<T>( value.size ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+// Fallback for enums, extensions and nested structs
+template <typename T>
+SBP_FORCE_INLINE size_t packed_size( size_tag, const T &value ) SBP_NOEXCEPT
+{
+	if constexpr ( std::is_enum_v<T> )
+		return packed_size( size_tag(), std::underlying_type_t<T>( value ) );
+	else if constexpr ( is_extension_v<T> )
+		return ext_header_size( sizeof( T ) ) + sizeof( T );
+	else
+	{
+		return apply_members( value, []( const auto &... members ) SBP_NOEXCEPT
+		{
+			return ( size_t( 0 ) + ... + packed_size( size_tag(), members ) );
+		} );
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename... T>
+struct type_list { };
+
+// Collects types of structure members (only used in unevaluated context)
+struct member_types_fn
+{
+	template <typename... M>
+	type_list<std::remove_cv_t<M>...> operator()( M &... ) const SBP_NOEXCEPT { return { }; }
+};
+
+template <typename T>
+using member_types_t = decltype( apply_members( std::declval<const T &>(), member_types_fn() ) );
+
+// Specialized for std::array in STL section
+template <typename T>
+struct std_array_traits { static constexpr bool value = false; };
+
+// Returned by max_size_of for types without compile-time known maximum size (strings, vectors, maps...)
+constexpr size_t variable_size = size_t( -1 );
+
+template <typename T>
+constexpr size_t max_size_of() SBP_NOEXCEPT;
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename... M>
+constexpr size_t max_size_of_members( type_list<M...> ) SBP_NOEXCEPT
+{
+	const size_t sizes[] = { 0, max_size_of<M>()... };
+	size_t result = 0;
+
+	for ( auto size : sizes )
+	{
+		if ( size == variable_size )
+			return variable_size;
+
+		result += size;
+	}
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Maximum number of bytes written for any value of type T, follows the same decomposition as sbp::write
+template <typename T>
+constexpr size_t max_size_of() SBP_NOEXCEPT
+{
+	if constexpr ( std::is_same_v<T, bool> )
+		return 1;
+	else if constexpr ( std::is_arithmetic_v<T> || std::is_enum_v<T> )
+		return 1 + sizeof( T );
+	else if constexpr ( is_extension_v<T> )
+		return ext_header_size( sizeof( T ) ) + sizeof( T );
+	else if constexpr ( std_array_traits<T>::value )
+	{
+		using ValueType = typename std_array_traits<T>::value_type;
+		constexpr size_t numValues = std_array_traits<T>::size;
+
+		if constexpr ( use_packed_v<ValueType> )
+			return packed_size_packed<ValueType>( numValues );
+		else if constexpr ( max_size_of<ValueType>() == variable_size )
+			return variable_size;
+		else
+			return array_header_size( numValues ) + numValues * max_size_of<ValueType>();
+	}
+	else if constexpr ( std::is_class_v<T> && std::is_aggregate_v<T> )
+		return max_size_of_members( member_types_t<T>() );
+	else
+		return variable_size;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Upper bound of packed_size, does not branch on actual values (integers and lengths are expected at their maximum)
+SBP_FORCE_INLINE size_t max_packed_size( size_tag, const char *value ) SBP_NOEXCEPT { return 5 + ( value ? ( strlen( value ) + 1 ) : 0 ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+SBP_FORCE_INLINE size_t max_packed_size_array( const T *values, size_t numValues ) SBP_NOEXCEPT
+{
+	if constexpr ( max_size_of<T>() != variable_size )
+		return 5 + numValues * max_size_of<T>();
+	else
+	{
+		size_t result = 5;
+
+		for ( size_t i = 0; i < numValues; ++i )
+			result += max_packed_size( size_tag(), values[i] );
+
+		return result;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+SBP_FORCE_INLINE size_t max_packed_size_map( const T &value ) SBP_NOEXCEPT
+{
+	size_t result = 5;
+
+	for ( const auto & [k, v] : value )
+		result += max_packed_size( size_tag(), k ) + max_packed_size( size_tag(), v );
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, size_t NumValues>
+SBP_FORCE_INLINE size_t max_packed_size( size_tag, const T( &value )[NumValues] ) SBP_NOEXCEPT { return max_packed_size_array( value, NumValues ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+SBP_FORCE_INLINE size_t max_packed_size( size_tag, const packed_view<T> &value ) SBP_NOEXCEPT { return packed_size_packed<T>( value.size ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+// Fallback for primitive types, enums, extensions and nested structs
+template <typename T>
+SBP_FORCE_INLINE size_t max_packed_size( size_tag, const T &value ) SBP_NOEXCEPT
+{
+	if constexpr ( max_size_of<T>() != variable_size )
+		return max_size_of<T>();
+	else
+	{
+		return apply_members( value, []( const auto &... members ) SBP_NOEXCEPT
+		{
+			return ( size_t( 0 ) + ... + max_packed_size( size_tag(), members ) );
+		} );
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Classification of the first byte of a value. Readers accepting several headers (integers, lengths, bool, bin, ext
+// of any size), skip and scanners dispatch through header_infos table, readers accepting exactly one header (float,
+// double, ext of fixed size) compare it directly, which is cheaper than the lookup.
+struct header_info final
+{
+	enum family_type : uint8_t { invalid, nil, boolean, fixint, int_, uint_, float_, str, bin, ext, array, map };
+
+	family_type family;
+
+	// Size of length (or element count) field following the header
+	uint8_t lengthBytes;
+
+	// Number of bytes following the header and length field, which are not included in length (integer and float
+	// data, ext type and fixext data)
+	uint8_t payload;
+
+	// Length of fixstr, element count of fixarray and fixmap
+	uint8_t length;
+
+	// Value of fixint and bool
+	int8_t value;
+};
+
+struct header_table final
+{
+	header_info entries[256];
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+constexpr header_table make_header_table() SBP_NOEXCEPT
+{
+	using hi = header_info;
+	header_table result = { };
+
+	for ( unsigned i = 0; i < 256; ++i )
+	{
+		auto &entry = result.entries[i];
+
+		if ( i <= 0x7fu || i >= 0xe0u )
+			entry = { hi::fixint, 0, 0, 0, int8_t( uint8_t( i ) ) };
+		else if ( i <= 0x8fu )
+			entry = { hi::map, 0, 0, uint8_t( i & 0x0fu ), 0 };
+		else if ( i <= 0x9fu )
+			entry = { hi::array, 0, 0, uint8_t( i & 0x0fu ), 0 };
+		else if ( i <= 0xbfu )
+			entry = { hi::str, 0, 0, uint8_t( i & 0x1fu ), 0 };
+	}
+
+	auto *e = result.entries;
+	e[0xc0] = { hi::nil, 0, 0, 0, 0 };
+	e[0xc2] = { hi::boolean, 0, 0, 0, 0 };
+	e[0xc3] = { hi::boolean, 0, 0, 0, 1 };
+	e[0xc4] = { hi::bin, 1, 0, 0, 0 };
+	e[0xc5] = { hi::bin, 2, 0, 0, 0 };
+	e[0xc6] = { hi::bin, 4, 0, 0, 0 };
+	e[0xc7] = { hi::ext, 1, 1, 0, 0 };
+	e[0xc8] = { hi::ext, 2, 1, 0, 0 };
+	e[0xc9] = { hi::ext, 4, 1, 0, 0 };
+	e[0xca] = { hi::float_, 0, 4, 0, 0 };
+	e[0xcb] = { hi::float_, 0, 8, 0, 0 };
+	e[0xcc] = { hi::uint_, 0, 1, 0, 0 };
+	e[0xcd] = { hi::uint_, 0, 2, 0, 0 };
+	e[0xce] = { hi::uint_, 0, 4, 0, 0 };
+	e[0xcf] = { hi::uint_, 0, 8, 0, 0 };
+	e[0xd0] = { hi::int_, 0, 1, 0, 0 };
+	e[0xd1] = { hi::int_, 0, 2, 0, 0 };
+	e[0xd2] = { hi::int_, 0, 4, 0, 0 };
+	e[0xd3] = { hi::int_, 0, 8, 0, 0 };
+	e[0xd4] = { hi::ext, 0, 1 + 1, 0, 0 };
+	e[0xd5] = { hi::ext, 0, 1 + 2, 0, 0 };
+	e[0xd6] = { hi::ext, 0, 1 + 4, 0, 0 };
+	e[0xd7] = { hi::ext, 0, 1 + 8, 0, 0 };
+	e[0xd8] = { hi::ext, 0, 1 + 16, 0, 0 };
+	e[0xd9] = { hi::str, 1, 0, 0, 0 };
+	e[0xda] = { hi::str, 2, 0, 0, 0 };
+	e[0xdb] = { hi::str, 4, 0, 0, 0 };
+	e[0xdc] = { hi::array, 2, 0, 0, 0 };
+	e[0xdd] = { hi::array, 4, 0, 0, 0 };
+	e[0xde] = { hi::map, 2, 0, 0, 0 };
+	e[0xdf] = { hi::map, 4, 0, 0, 0 };
+	return result;
+}
+
+inline constexpr header_table header_infos = make_header_table();
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+SBP_FORCE_INLINE error read_int( buffer &b, T &value ) SBP_NOEXCEPT
+{
+	const auto &info = header_infos.entries[b.read<uint8_t>()];
+
+	if ( info.family == header_info::fixint )
+	{
+		value = static_cast<T>( info.value );
+		return b.valid();
+	}
+	else if ( info.family != header_info::int_ )
+		return { error::corrupted_data };
+
+	switch ( info.payload )
+	{
+		case 1: return b.read<int8_t>( value );
+		case 2: return b.read<int16_t>( value );
+		case 4: return b.read<int32_t>( value );
+		default: return b.read<int64_t>( value );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE error read( buffer &b, int8_t  &value ) SBP_NOEXCEPT { return read_int( b, value ); }
+SBP_FORCE_INLINE error read( buffer &b, int16_t &value ) SBP_NOEXCEPT { return read_int( b, value ); }
+SBP_FORCE_INLINE error read( buffer &b, int32_t &value ) SBP_NOEXCEPT { return read_int( b, value ); }
+SBP_FORCE_INLINE error read( buffer &b, int64_t &value ) SBP_NOEXCEPT { return read_int( b, value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+SBP_FORCE_INLINE error read_uint( buffer &b, T &value ) SBP_NOEXCEPT
+{
+	const auto &info = header_infos.entries[b.read<uint8_t>()];
+
+	// Negative fixint is not allowed
+	if ( info.family == header_info::fixint && info.value >= 0 )
+	{
+		value = static_cast<T>( info.value );
+		return b.valid();
+	}
+	else if ( info.family != header_info::uint_ )
+		return { error::corrupted_data };
+
+	switch ( info.payload )
+	{
+		case 1: return b.read<uint8_t>( value );
+		case 2: return b.read<uint16_t>( value );
+		case 4: return b.read<uint32_t>( value );
+		default: return b.read<uint64_t>( value );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE error read( buffer &b, uint8_t  &value ) SBP_NOEXCEPT { return read_uint( b, value ); }
+SBP_FORCE_INLINE error read( buffer &b, uint16_t &value ) SBP_NOEXCEPT { return read_uint( b, value ); }
+SBP_FORCE_INLINE error read( buffer &b, uint32_t &value ) SBP_NOEXCEPT { return read_uint( b, value ); }
+SBP_FORCE_INLINE error read( buffer &b, uint64_t &value ) SBP_NOEXCEPT { return read_uint( b, value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reads length (or element count) of a value of given family
+template <header_info::family_type Family>
+SBP_FORCE_INLINE error read_length( buffer &b, size_t &value ) SBP_NOEXCEPT
+{
+	const auto &info = header_infos.entries[b.read<uint8_t>()];
+	if ( info.family != Family )
+		return { error::corrupted_data };
+
+	switch ( info.lengthBytes )
+	{
+		case 0: value = info.length; return b.valid();
+		case 1: return b.read<uint8_t>( value );
+		case 2: return b.read<uint16_t>( value );
+		default: return b.read<uint32_t>( value );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE error read_string_length( buffer &b, size_t &value ) SBP_NOEXCEPT { return read_length<header_info::str>( b, value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE error read( buffer &b, const char *&value ) SBP_NOEXCEPT
+{
+	size_t length = 0;
+	if ( auto err = read_string_length( b, length ) )
+		return err;
+
+	value = reinterpret_cast<const char *>( b.acquire( length ) );
+	return b.valid();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Single accepted header is compared directly (no header_infos lookup)
+SBP_FORCE_INLINE error read( buffer &b, float &value ) SBP_NOEXCEPT
+{
+	if ( b.read<uint8_t>() != 0xcau )
+		return { error::corrupted_data };
+
+	return b.read<float>( value );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE error read( buffer &b, double &value ) SBP_NOEXCEPT
+{
+	if ( b.read<uint8_t>() != 0xcbu )
+		return { error::corrupted_data };
+
+	return b.read<double>( value );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE error read( buffer &b, bool &value ) SBP_NOEXCEPT
+{
+	const auto &info = header_infos.entries[b.read<uint8_t>()];
+	if ( info.family != header_info::boolean )
+		return { error::corrupted_data };
+
+	value = ( info.value != 0 );
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE error read_array_length( buffer &b, size_t &value ) SBP_NOEXCEPT { return read_length<header_info::array>( b, value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE error read_map_length( buffer &b, size_t &value ) SBP_NOEXCEPT { return read_length<header_info::map>( b, value ); }
+
+template <typename T, typename = void>
+struct has_reserve : std::false_type { };
+
+template <typename T>
+struct has_reserve<T, std::void_t<decltype( std::declval<T &>().reserve( size_t() ) )>> : std::true_type { };
+
+template <typename T, typename K, typename V, typename = void>
+struct has_insert_or_assign : std::false_type { };
+
+template <typename T, typename K, typename V>
+struct has_insert_or_assign<T, K, V, std::void_t<decltype( std::declval<T &>().insert_or_assign(
+	std::declval<T &>().end(), std::declval<K>(), std::declval<V>() ) )>> : std::true_type { };
+
+//---------------------------------------------------------------------------------------------------------------------
+// Hash maps get buckets for all entries up front, so they never rehash while decoding. Every entry takes at least two
+// bytes, so the count is not trusted beyond the data already in the buffer (streams just rehash for the rest).
+template <typename T>
+SBP_FORCE_INLINE void reserve_map( buffer &b, T &value, size_t numValues ) SBP_NOEXCEPT
+{
+	if constexpr ( has_reserve<T>::value )
+	{
+		size_t maxValues = ( b.size() - b.tell() ) / 2;
+		value.reserve( ( numValues < maxValues ) ? numValues : maxValues );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Resizes vector for numValues elements, each taking at least minBytes. The count is not trusted beyond the data
+// already in the buffer, elements past it are appended as they are decoded (streams keep their window bounded).
+template <typename T>
+SBP_FORCE_INLINE void resize_readable( buffer &b, T &value, size_t numValues, size_t minBytes ) SBP_NOEXCEPT
+{
+	size_t maxValues = ( b.size() - b.tell() ) / minBytes;
+	value.resize( ( numValues < maxValues ) ? numValues : maxValues );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Moves the entry straight into a new node, hinting the end makes sorted keys (as written from std::map) insert in
+// constant time. Last value of duplicate keys wins.
+template <typename T, typename K, typename V>
+SBP_FORCE_INLINE void insert_map( T &value, K &&key, V &&mapped ) SBP_NOEXCEPT
+{
+	if constexpr ( has_insert_or_assign<T, K, V>::value )
+		value.insert_or_assign( value.end(), std::forward<K>( key ), std::forward<V>( mapped ) );
+	else
+		value[std::forward<K>( key )] = std::forward<V>( mapped );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename KeyType, typename ValueType>
+SBP_FORCE_INLINE error read_map( buffer &b, T &value ) SBP_NOEXCEPT
+{
+	size_t numValues = 0;
+	if ( auto err = read_map_length( b, numValues ) )
+		return err;
+
+	value.clear();
+	reserve_map( b, value, numValues );
+
+	for ( size_t i = 0; i < numValues; ++i )
+	{
+		KeyType k;
+		if ( auto err = read( b, k ) )
+			return err;
+
+		ValueType v;
+		if ( auto err = read( b, v ) )
+			return err;
+
+		insert_map( value, std::move( k ), std::move( v ) );
+	}
+
+	return b.valid();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Size is known at compile time, so exactly one header (and length) is accepted and compared directly
+template <size_t NumBytes, int8_t TypeID = 0>
+SBP_FORCE_INLINE error read_ext( buffer &b, const void *&value ) SBP_NOEXCEPT
+{
+	auto header = b.read<uint8_t>();
+	if constexpr ( NumBytes == 1 )
+	{
+		if ( header != 0xd4u )
+			return { error::corrupted_data };
+	}
+	else if constexpr ( NumBytes == 2 )
+	{
+		if ( header != 0xd5u )
+			return { error::corrupted_data };
+	}
+	else if constexpr ( NumBytes == 4 )
+	{
+		if ( header != 0xd6u )
+			return { error::corrupted_data };
+	}
+	else if constexpr ( NumBytes == 8 )
+	{
+		if ( header != 0xd7u )
+			return { error::corrupted_data };
+	}
+	else if constexpr ( NumBytes == 16 )
+	{
+		if ( header != 0xd8u )
+			return { error::corrupted_data };
+	}
+	else if constexpr ( NumBytes <= 255 )
+	{
+		if ( header != 0xc7u || b.read<uint8_t>() != NumBytes )
+			return { error::corrupted_data };
+	}
+	else if constexpr ( NumBytes <= 65535 )
+	{
+		if ( header != 0xc8u || b.read<uint16_t>() != NumBytes )
+			return { error::corrupted_data };
+	}
+	else
+	{
+		if ( header != 0xc9u || b.read<uint32_t>() != NumBytes )
+			return { error::corrupted_data };
+	}
+
+	if ( b.read<int8_t>() != TypeID )
+		return { error::corrupted_data };
+
+	value = b.acquire( NumBytes );
+	return b.valid();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE error read_bin( buffer &b, const void *&value, size_t &numBytes ) SBP_NOEXCEPT
+{
+	if ( auto err = read_length<header_info::bin>( b, numBytes ) )
+		return err;
+
+	value = b.acquire( numBytes );
+	return b.valid();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE error read_ext_header( buffer &b, int8_t &type, size_t &numBytes ) SBP_NOEXCEPT
+{
+	const auto &info = header_infos.entries[b.read<uint8_t>()];
+	if ( info.family != header_info::ext )
+		return { error::corrupted_data };
+
+	error err;
+
+	// Payload of fixext includes the type
+	switch ( info.lengthBytes )
+	{
+		case 0: numBytes = info.payload - 1u; break;
+		case 1: err = b.read<uint8_t>( numBytes ); break;
+		case 2: err = b.read<uint16_t>( numBytes ); break;
+		default: err = b.read<uint32_t>( numBytes ); break;
+	}
+
+	if ( err )
+		return err;
+
+	type = b.read<int8_t>();
+	return b.valid();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE error read_ext( buffer &b, int8_t &type, const void *&value, size_t &numBytes ) SBP_NOEXCEPT
+{
+	if ( auto err = read_ext_header( b, type, numBytes ) )
+		return err;
+
+	value = b.acquire( numBytes );
+	return b.valid();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reads header of a packed array (bin, or ext of the extension type) without touching its data
+template <typename T>
+SBP_FORCE_INLINE error read_packed_length( buffer &b, size_t &numValues ) SBP_NOEXCEPT
+{
+	static_assert( is_packable_v<T>, "read_packed requires arithmetic or trivially copyable SBP_EXTENSION type" );
+
+	size_t numBytes = 0;
+
+	if constexpr ( is_extension_v<T> )
+	{
+		int8_t type = 0;
+		if ( auto err = read_ext_header( b, type, numBytes ) )
+			return err;
+
+		if ( type != extension<T>::type_id )
+			return { error::corrupted_data };
+	}
+	else
+	{
+		if ( auto err = read_length<header_info::bin>( b, numBytes ) )
+			return err;
+	}
+
+	if ( numBytes % sizeof( T ) )
+		return { error::corrupted_data };
+
+	numValues = numBytes / sizeof( T );
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+SBP_FORCE_INLINE error read_packed( buffer &b, const T *&values, size_t &numValues ) SBP_NOEXCEPT
+{
+	if ( auto err = read_packed_length<T>( b, numValues ) )
+		return err;
+
+	values = static_cast<const T *>( b.acquire( numValues * sizeof( T ) ) );
+	return b.valid();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+SBP_FORCE_INLINE error read( buffer &b, packed_view<T> &value ) SBP_NOEXCEPT { return read_packed( b, value.data, value.size ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename... Tail>
+error read_multiple( buffer &b, T &value, Tail &... tail ) SBP_NOEXCEPT
+{
+	error err;
+
+	if constexpr ( std::is_enum_v<T> )
+	{
+		std::underlying_type_t<T> underlyingValue = { };
+		err = read( b, underlyingValue );
+		value = static_cast<T>( underlyingValue );
+	}
+	else
+		err = read( b, value );
+
+	if constexpr ( sizeof...( Tail ) > 0 )
+	{
+		if ( auto err = read_multiple( b, tail... ) )
+			return err;
+	}
+
+	return err;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE size_t load_length( const uint8_t *data, size_t numBytes ) SBP_NOEXCEPT
+{
+	if ( numBytes == 1 )
+		return data[0];
+	else if ( numBytes == 2 )
+	{
+		uint16_t value;
+		memcpy( &value, data, sizeof( value ) );
+		return wire_order( value );
+	}
+
+	uint32_t value;
+	memcpy( &value, data, sizeof( value ) );
+	return wire_order( value );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Skips numValues values including all nested arrays and maps (pending values are just counted, no recursion)
+inline error skip_values( buffer &b, size_t numValues ) SBP_NOEXCEPT
+{
+	// Fast path over data already in memory, stops before the first value which is not complete
+	const uint8_t *cursor = b.data() + b.tell();
+	const uint8_t *end = b.data() + b.size();
+
+	while ( numValues > 0 && cursor + 5 <= end )
+	{
+		const auto &info = header_infos.entries[*cursor];
+
+		// Length field is never longer than 4 bytes, so it can be read without checking the size
+		size_t length = info.lengthBytes ? load_length( cursor + 1, info.lengthBytes ) : info.length;
+		size_t headerSize = 1u + info.lengthBytes;
+
+		if ( info.family == header_info::array )
+			numValues += length;
+		else if ( info.family == header_info::map )
+			numValues += length * 2;
+		else if ( info.family == header_info::invalid )
+			return { error::corrupted_data };
+		else
+		{
+			headerSize += info.payload + length;
+			if ( headerSize > static_cast<size_t>( end - cursor ) )
+				break;
+		}
+
+		cursor += headerSize;
+		--numValues;
+	}
+
+	b.seek( static_cast<size_t>( cursor - b.data() ) );
+
+	for ( ; numValues > 0; --numValues )
+	{
+		const auto &info = header_infos.entries[b.read<uint8_t>()];
+
+		size_t length = 0;
+		if ( info.lengthBytes == 1 )
+			length = b.read<uint8_t>();
+		else if ( info.lengthBytes == 2 )
+			length = b.read<uint16_t>();
+		else if ( info.lengthBytes == 4 )
+			length = b.read<uint32_t>();
+		else
+			length = info.length;
+
+		if ( info.family == header_info::array )
+			numValues += length;
+		else if ( info.family == header_info::map )
+			numValues += length * 2;
+		else if ( info.family == header_info::invalid )
+			return { error::corrupted_data };
+		else
+			b.discard( info.payload + length );
+
+		// Do not keep counting values past the end of corrupted data
+		if ( auto err = b.valid() )
+			return err;
+	}
+
+	return { error::none };
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Shape of a value written by sbp::write, lets scanners find value boundaries without knowing C++ types at runtime
+struct layout_node final
+{
+	enum kind_type : uint8_t
+	{
+		single,  // value without nested values (integer, string, bin, ext...)
+		array,   // array header followed by elements (children[0])
+		map,     // map header followed by key (children[0]) and value (children[1]) pairs
+		members, // members of a struct (children[0..numChildren)), written one after another without any header
+		tuple    // array header followed by one value of each child (children[0..numChildren))
+	};
+
+	kind_type kind;
+	uint32_t numChildren;
+	const layout_node *const *children;
+};
+
+// Specialized for containers in STL sections (with children type_list holding element or key and value types)
+template <typename T>
+struct layout_of;
+
+template <typename... T>
+struct layout_list { static constexpr const layout_node *nodes[] = { &layout_of<T>::node..., nullptr }; };
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename... M>
+constexpr layout_node members_layout( type_list<M...> ) SBP_NOEXCEPT
+{
+	return { layout_node::members, uint32_t( sizeof...( M ) ), layout_list<M...>::nodes };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Nested structs are written member by member, everything else (enums, extensions, strings...) as a single value
+template <typename T>
+struct layout_of
+{
+	static constexpr layout_node node = [] () constexpr
+	{
+		if constexpr ( std::is_class_v<T> && std::is_aggregate_v<T> && !is_extension_v<T> )
+			return members_layout( member_types_t<T>() );
+		else
+			return layout_node{ layout_node::single, 0, nullptr };
+	}();
+};
+
+template <typename T>
+struct layout_of<packed_view<T>> { static constexpr layout_node node = { layout_node::single, 0, nullptr }; };
+
+//---------------------------------------------------------------------------------------------------------------------
+// Computes size of a single value (array and map headers only count the header itself, numValues is then set to the
+// number of elements). Returns error::unexpected_end when the header is incomplete.
+SBP_FORCE_INLINE error value_size( const uint8_t *data, size_t available, size_t &numBytes, size_t &numValues ) SBP_NOEXCEPT
+{
+	if ( available == 0 )
+		return { error::unexpected_end };
+
+	const auto &info = header_infos.entries[data[0]];
+	if ( info.family == header_info::invalid )
+		return { error::corrupted_data };
+
+	if ( available < 1u + info.lengthBytes )
+		return { error::unexpected_end };
+
+	size_t length = info.lengthBytes ? load_length( data + 1, info.lengthBytes ) : info.length;
+	if ( info.family == header_info::array || info.family == header_info::map )
+	{
+		numBytes = 1 + info.lengthBytes;
+		numValues = length;
+	}
+	else
+	{
+		numBytes = 1 + info.lengthBytes + info.payload + length;
+		numValues = 0;
+	}
+
+	return { error::none };
+}
+
+// Position of a scanner inside a partially received message
+struct scan_state final
+{
+	static constexpr uint32_t max_depth = 64;
+
+	struct frame final
+	{
+		const layout_node *node;
+		size_t remaining;
+	};
+
+	frame frames[max_depth];
+	uint32_t depth = 0;
+
+	// Number of bytes of the message scanned so far
+	size_t offset = 0;
+
+	void start( const layout_node *root ) SBP_NOEXCEPT
+	{
+		frames[0] = { root, root->numChildren };
+		depth = 1;
+		offset = 0;
+	}
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Walks message layout over available data. Returns error::unexpected_end when the message is incomplete, scanning
+// can be resumed from the same state once more data arrive (only the last incomplete value is looked at again).
+inline error scan( scan_state &state, const uint8_t *data, size_t size ) SBP_NOEXCEPT
+{
+	// Cursor and remaining count are kept in locals, byte loads could alias the state otherwise
+	size_t offset = state.offset;
+	error result;
+
+	while ( state.depth > 0 )
+	{
+		auto &frame = state.frames[state.depth - 1];
+		const layout_node *parent = frame.node;
+		size_t remaining = frame.remaining;
+
+		// Nested struct or container to descend into
+		const layout_node *child = nullptr;
+
+		while ( remaining > 0 )
+		{
+			const layout_node *node = nullptr;
+			if ( parent->kind == layout_node::members || parent->kind == layout_node::tuple )
+				node = parent->children[parent->numChildren - remaining];
+			else if ( parent->kind == layout_node::map )
+				node = parent->children[remaining & 1];
+			else
+				node = parent->children[0];
+
+			if ( node->kind != layout_node::single )
+			{
+				child = node;
+				break;
+			}
+
+			size_t numBytes = 0;
+			size_t numValues = 0;
+			if ( ( result = value_size( data + offset, size - offset, numBytes, numValues ) ) )
+				break;
+
+			auto family = header_infos.entries[data[offset]].family;
+			if ( family == header_info::array || family == header_info::map )
+			{
+				result = { error::corrupted_data };
+				break;
+			}
+
+			if ( size - offset < numBytes )
+			{
+				result = { error::unexpected_end };
+				break;
+			}
+
+			offset += numBytes;
+			--remaining;
+		}
+
+		frame.remaining = remaining;
+		if ( result )
+			break;
+
+		if ( !child )
+		{
+			--state.depth;
+			continue;
+		}
+
+		size_t numValues = child->numChildren;
+		if ( child->kind != layout_node::members )
+		{
+			size_t numBytes = 0;
+			if ( ( result = value_size( data + offset, size - offset, numBytes, numValues ) ) )
+				break;
+
+			auto family = header_infos.entries[data[offset]].family;
+			if ( family != ( ( child->kind == layout_node::map ) ? header_info::map : header_info::array ) ||
+			     ( child->kind == layout_node::tuple && numValues != child->numChildren ) )
+			{
+				result = { error::corrupted_data };
+				break;
+			}
+
+			offset += numBytes;
+			if ( child->kind == layout_node::map )
+				numValues *= 2;
+		}
+
+		if ( state.depth == scan_state::max_depth )
+		{
+			result = { error::corrupted_data };
+			break;
+		}
+
+		--frame.remaining;
+		state.frames[state.depth++] = { child, numValues };
+	}
+
+	state.offset = offset;
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+SBP_FORCE_INLINE error skip_as( buffer &b ) SBP_NOEXCEPT;
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename... M>
+SBP_FORCE_INLINE error skip_members( buffer &b, type_list<M...> ) SBP_NOEXCEPT
+{
+	error err;
+	( ( err = skip_as<M>( b ) ) || ... );
+	return err;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Skips a value of type T without decoding it. Nested structs are not preceded by any header, so they cannot be
+// skipped structurally. Numbers go through regular readers, whose branches predict well on uniform data, strings,
+// blobs and extensions are skipped by their length.
+template <typename T>
+SBP_FORCE_INLINE error skip_as( buffer &b ) SBP_NOEXCEPT
+{
+	constexpr auto kind = layout_of<T>::node.kind;
+
+	if constexpr ( std::is_enum_v<T> )
+	{
+		std::underlying_type_t<T> value;
+		return read( b, value );
+	}
+	else if constexpr ( std::is_arithmetic_v<T> )
+	{
+		T value;
+		return read( b, value );
+	}
+	else if constexpr ( kind == layout_node::members )
+		return skip_members( b, member_types_t<T>() );
+	else if constexpr ( kind == layout_node::single )
+		return skip_values( b, 1 );
+	else if constexpr ( kind == layout_node::tuple )
+	{
+		size_t numValues = 0;
+		if ( auto err = read_array_length( b, numValues ) )
+			return err;
+
+		if ( numValues != layout_of<T>::node.numChildren )
+			return { error::corrupted_data };
+
+		return skip_members( b, typename layout_of<T>::children() );
+	}
+	else
+	{
+		size_t numValues = 0;
+		if ( auto err = ( kind == layout_node::array ) ? read_array_length( b, numValues ) : read_map_length( b, numValues ) )
+			return err;
+
+		// Element (or key and value pair)
+		for ( size_t i = 0; i < numValues; ++i )
+		{
+			if ( auto err = skip_members( b, typename layout_of<T>::children() ) )
+				return err;
+		}
+
+		return b.valid();
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <size_t Index, typename M, typename... Tail>
+SBP_FORCE_INLINE auto &pick( M &member, Tail &... tail ) SBP_NOEXCEPT
+{
+	if constexpr ( Index == 0 )
+		return member;
+	else
+		return pick<Index - 1>( tail... );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Returns reference to member at given index of structured binding list
+template <size_t Index, typename T>
+SBP_FORCE_INLINE auto &member_at( T &msg ) SBP_NOEXCEPT
+{
+	return apply_members( msg, []( auto &... members ) SBP_NOEXCEPT -> auto & { return pick<Index>( members... ); } );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <size_t Index, size_t... Selected>
+constexpr bool is_selected_v = ( ( Index == Selected ) || ... );
+
+//---------------------------------------------------------------------------------------------------------------------
+template <size_t... Selected, size_t... Indices, typename... M>
+SBP_FORCE_INLINE error read_selected( buffer &b, std::index_sequence<Indices...>, M &... members ) SBP_NOEXCEPT
+{
+	static_assert( ( ( Selected < sizeof...( M ) ) && ... ), "selected member index is out of range" );
+
+	error err;
+	auto readOrSkip = [&b]( auto selected, auto &member ) SBP_NOEXCEPT -> error
+	{
+		if constexpr ( decltype( selected )::value )
+			return read_multiple( b, member );
+		else
+			return skip_as<std::remove_cv_t<std::remove_reference_t<decltype( member )>>>( b );
+	};
+
+	// Stops at the first error
+	( ( err = readOrSkip( std::bool_constant<is_selected_v<Indices, Selected...>>(), members ) ) || ... );
+	return err;
+}
+
+} // namespace sbp::detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(SBP_MSVC)
+	#if defined(_ARRAY_) && !defined(SBP_STL_ARRAY)
+		#define SBP_STL_ARRAY
+	#endif
+
+	#if defined(_MAP_) && !defined(SBP_STL_MAP)
+		#define SBP_STL_MAP
+	#endif
+
+	#if defined(_MEMORY_RESOURCE_) && !defined(SBP_STL_MEMORY_RESOURCE)
+		#define SBP_STL_MEMORY_RESOURCE
+	#endif
+
+	#if defined(_STRING_) && !defined(SBP_STL_STRING)
+		#define SBP_STL_STRING
+	#endif
+
+	#if defined(_STRING_VIEW_) && !defined(SBP_STL_STRING_VIEW)
+		#define SBP_STL_STRING_VIEW
+	#endif
+
+	#if defined(_THREAD_) && !defined(SBP_STL_THREAD)
+		#define SBP_STL_THREAD
+	#endif
+
+	#if defined(_UNORDERED_MAP_) && !defined(SBP_STL_UNORDERED_MAP)
+		#define SBP_STL_UNORDERED_MAP
+	#endif
+
+	#if defined(_VECTOR_) && !defined(SBP_STL_VECTOR)
+		#define SBP_STL_VECTOR
+	#endif
+#endif
+
+namespace sbp::detail {
+
+#if defined(SBP_STL_STRING_VIEW) && defined(SBP_STL_VECTOR)
+// Reads a string, which might be interned (defined in string interning section)
+inline error read_interned( buffer &b, std::string_view &value ) SBP_NOEXCEPT;
+#endif
+
+#if defined(SBP_STL_MEMORY_RESOURCE)
+// Memory resource bound to the current read call on this thread (see sbp::read taking a memory resource)
+inline thread_local std::pmr::memory_resource *bound_resource = nullptr;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Rebuilds empty container using polymorphic allocator with the bound memory resource, unless it already uses it.
+// Containers with any other allocator compile to nothing, the thread_local resource is never loaded for them.
+template <typename T>
+SBP_FORCE_INLINE void bind_resource( T &value ) SBP_NOEXCEPT
+{
+	using allocator_type = typename T::allocator_type;
+
+	if constexpr ( std::is_same_v<allocator_type, std::pmr::polymorphic_allocator<typename allocator_type::value_type>> )
+	{
+		auto *resource = bound_resource;
+		if ( resource && value.get_allocator().resource() != resource )
+		{
+			value.~T();
+			new ( &value ) T( allocator_type( resource ) );
+		}
+	}
+}
+#else
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+SBP_FORCE_INLINE void bind_resource( T & ) SBP_NOEXCEPT { }
+#endif
+
+#if defined(SBP_STL_ARRAY)
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, size_t NumValues>
+struct std_array_traits<std::array<T, NumValues>>
+{
+	static constexpr bool value = true;
+	static constexpr size_t size = NumValues;
+	using value_type = T;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename T, size_t NumValues>
+SBP_FORCE_INLINE void write( Buffer &b, const std::array<T, NumValues> &value ) SBP_NOEXCEPT
+{
+	if constexpr ( use_packed_v<T> )
+		write_packed( b, value.data(), NumValues );
+	else
+		write_array( b, value.data(), NumValues );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, size_t NumValues>
+SBP_FORCE_INLINE size_t packed_size( size_tag, const std::array<T, NumValues> &value ) SBP_NOEXCEPT
+{
+	if constexpr ( use_packed_v<T> )
+		return packed_size_packed<T>( NumValues );
+	else
+		return packed_size_array( value.data(), NumValues );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, size_t NumValues>
+SBP_FORCE_INLINE size_t max_packed_size( size_tag, const std::array<T, NumValues> &value ) SBP_NOEXCEPT
+{
+	if constexpr ( use_packed_v<T> )
+		return packed_size_packed<T>( NumValues );
+	else
+		return max_packed_size_array( value.data(), NumValues );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, size_t NumValues>
+SBP_FORCE_INLINE error read( buffer &b, std::array<T, NumValues> &value ) SBP_NOEXCEPT
+{
+	if constexpr ( use_packed_v<T> )
+	{
+		const T *values = nullptr;
+		size_t numValues = 0;
+		if ( auto err = read_packed( b, values, numValues ) )
+			return err;
+
+		if ( numValues != NumValues )
+			return { error::corrupted_data };
+
+		copy_wire_order( value.data(), values, NumValues );
+		return b.valid();
+	}
+
+	size_t numValues = 0;
+	if ( auto err = read_array_length( b, numValues ) )
+		return err;
+
+	if ( numValues != NumValues )
+		return { error::corrupted_data };
+
+	for ( size_t i = 0; i < NumValues; ++i )
+	{
+		if ( auto err = read( b, value[i] ) )
+			return err;
+	}
+
+	return b.valid();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, size_t NumValues>
+struct layout_of<std::array<T, NumValues>>
+{
+	using children = type_list<T>;
+
+	static constexpr layout_node node = use_packed_v<T> ?
+		layout_node{ layout_node::single, 0, nullptr } : layout_node{ layout_node::array, 1, layout_list<T>::nodes };
+};
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(SBP_STL_VECTOR) && ( defined(SBP_STL_MAP) || defined(SBP_STL_UNORDERED_MAP) )
+// Nodes extracted from maps being decoded into, kept per map type and thread, so the vector does not allocate either
+template <typename T>
+inline thread_local std::vector<typename T::node_type> spare_nodes;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Decodes map into nodes of its previous contents, so neither the nodes nor memory of their keys and values have to
+// be allocated again when decoding similar maps
+template <typename T>
+inline error read_map_in_place( buffer &b, T &value ) SBP_NOEXCEPT
+{
+	size_t numValues = 0;
+	if ( auto err = read_map_length( b, numValues ) )
+		return err;
+
+	// Values might hold maps of the same type, so every call uses just its own part of spare nodes
+	auto &spare = spare_nodes<T>;
+	size_t first = spare.size();
+	size_t numReused = ( value.size() < numValues ) ? value.size() : numValues;
+
+	for ( size_t i = 0; i < numReused; ++i )
+		spare.push_back( value.extract( value.begin() ) );
+
+	value.clear();
+	reserve_map( b, value, numValues );
+
+	error err;
+	for ( size_t i = 0; i < numValues && !err; ++i )
+	{
+		if ( i < numReused )
+		{
+			// Key and value live in the node itself, so they stay put even when nested maps grow spare nodes
+			if ( ( err = read( b, spare[first + i].key() ) ) || ( err = read( b, spare[first + i].mapped() ) ) )
+				break;
+
+			// Node is left untouched when the key is already there, last value of duplicate keys wins
+			auto &node = spare[first + i];
+			auto position = value.insert( value.end(), std::move( node ) );
+			if ( !node.empty() )
+				position->second = std::move( node.mapped() );
+		}
+		else
+		{
+			typename T::key_type k;
+			if ( ( err = read( b, k ) ) )
+				break;
+
+			typename T::mapped_type v;
+			if ( ( err = read( b, v ) ) )
+				break;
+
+			insert_map( value, std::move( k ), std::move( v ) );
+		}
+	}
+
+	spare.erase( spare.begin() + first, spare.end() );
+	return err ? err : b.valid();
+}
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+SBP_FORCE_INLINE error read_std_map( buffer &b, T &value ) SBP_NOEXCEPT
+{
+	bind_resource( value );
+
+#if defined(SBP_STL_VECTOR)
+	if ( !value.empty() )
+		return read_map_in_place( b, value );
+#endif
+
+	return read_map<T, typename T::key_type, typename T::mapped_type>( b, value );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(SBP_STL_MAP)
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename K, typename T, typename P, typename A>
+SBP_FORCE_INLINE void write( Buffer &b, const std::map<K, T, P, A> &value ) SBP_NOEXCEPT { write_map( b, value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename K, typename T, typename P, typename A>
+SBP_FORCE_INLINE size_t packed_size( size_tag, const std::map<K, T, P, A> &value ) SBP_NOEXCEPT { return packed_size_map( value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename K, typename T, typename P, typename A>
+SBP_FORCE_INLINE size_t max_packed_size( size_tag, const std::map<K, T, P, A> &value ) SBP_NOEXCEPT { return max_packed_size_map( value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename K, typename T, typename P, typename A>
+SBP_FORCE_INLINE error read( buffer &b, std::map<K, T, P, A> &value ) SBP_NOEXCEPT { return read_std_map( b, value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename K, typename T, typename P, typename A>
+struct layout_of<std::map<K, T, P, A>>
+{
+	using children = type_list<K, T>;
+
+	static constexpr layout_node node = { layout_node::map, 2, layout_list<K, T>::nodes };
+};
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(SBP_STL_UNORDERED_MAP)
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename K, typename T, typename H, typename EQ, typename A>
+SBP_FORCE_INLINE void write( Buffer &b, const std::unordered_map<K, T, H, EQ, A> &value ) SBP_NOEXCEPT { write_map( b, value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename K, typename T, typename H, typename EQ, typename A>
+SBP_FORCE_INLINE size_t packed_size( size_tag, const std::unordered_map<K, T, H, EQ, A> &value ) SBP_NOEXCEPT { return packed_size_map( value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename K, typename T, typename H, typename EQ, typename A>
+SBP_FORCE_INLINE size_t max_packed_size( size_tag, const std::unordered_map<K, T, H, EQ, A> &value ) SBP_NOEXCEPT { return max_packed_size_map( value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename K, typename T, typename H, typename EQ, typename A>
+SBP_FORCE_INLINE error read( buffer &b, std::unordered_map<K, T, H, EQ, A> &value ) SBP_NOEXCEPT { return read_std_map( b, value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename K, typename T, typename H, typename EQ, typename A>
+struct layout_of<std::unordered_map<K, T, H, EQ, A>>
+{
+	using children = type_list<K, T>;
+
+	static constexpr layout_node node = { layout_node::map, 2, layout_list<K, T>::nodes };
+};
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(SBP_STL_STRING)
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename Tr, typename A>
+SBP_FORCE_INLINE void write( Buffer &b, const std::basic_string<char, Tr, A> &value ) SBP_NOEXCEPT { write_str( b, value.c_str(), value.length() ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Tr, typename A>
+SBP_FORCE_INLINE size_t packed_size( size_tag, const std::basic_string<char, Tr, A> &value ) SBP_NOEXCEPT { return str_header_size( value.length() ) + value.length(); }
+
+template <typename Tr, typename A>
+SBP_FORCE_INLINE size_t max_packed_size( size_tag, const std::basic_string<char, Tr, A> &value ) SBP_NOEXCEPT { return 5 + value.length(); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Tr, typename A>
+SBP_FORCE_INLINE error read( buffer &b, std::basic_string<char, Tr, A> &value ) SBP_NOEXCEPT
+{
+	bind_resource( value );
+
+#if defined(SBP_STL_STRING_VIEW) && defined(SBP_STL_VECTOR)
+	if ( b.strings() )
+	{
+		std::string_view interned;
+		if ( auto err = read_interned( b, interned ) )
+			return err;
+
+		value.assign( interned.data(), interned.length() );
+		return { error::none };
+	}
+#endif
+
+	size_t length = 0;
+	if ( auto err = read_string_length( b, length ) )
+		return err;
+
+	value.resize( length );
+	b.read( value.data(), length );
+	return b.valid();
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(SBP_STL_STRING_VIEW)
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer>
+SBP_FORCE_INLINE void write( Buffer &b, std::string_view value ) SBP_NOEXCEPT { write_str( b, value.data(), value.length() ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE size_t packed_size( size_tag, std::string_view value ) SBP_NOEXCEPT { return str_header_size( value.length() ) + value.length(); }
+SBP_FORCE_INLINE size_t max_packed_size( size_tag, std::string_view value ) SBP_NOEXCEPT { return 5 + value.length(); }
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE error read( buffer &b, std::string_view &value ) SBP_NOEXCEPT
+{
+#if defined(SBP_STL_VECTOR)
+	if ( b.strings() )
+		return read_interned( b, value );
+#endif
+
+	size_t length = 0;
+	if ( auto err = read_string_length( b, length ) )
+		return err;
+
+	value = std::string_view( reinterpret_cast<const char *>( b.acquire( length ) ), length );
+	return b.valid();
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(SBP_STL_VECTOR)
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename T, typename A>
+SBP_FORCE_INLINE void write( Buffer &b, const std::vector<T, A> &value ) SBP_NOEXCEPT
+{
+	if constexpr ( use_packed_v<T> )
+		write_packed( b, value.data(), value.size() );
+	else
+		write_array( b, value.data(), value.size() );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename A>
+SBP_FORCE_INLINE size_t packed_size( size_tag, const std::vector<T, A> &value ) SBP_NOEXCEPT
+{
+	if constexpr ( use_packed_v<T> )
+		return packed_size_packed<T>( value.size() );
+	else
+		return packed_size_array( value.data(), value.size() );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename A>
+SBP_FORCE_INLINE size_t max_packed_size( size_tag, const std::vector<T, A> &value ) SBP_NOEXCEPT
+{
+	if constexpr ( use_packed_v<T> )
+		return packed_size_packed<T>( value.size() );
+	else
+		return max_packed_size_array( value.data(), value.size() );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename A>
+SBP_FORCE_INLINE error read( buffer &b, std::vector<T, A> &value ) SBP_NOEXCEPT
+{
+	bind_resource( value );
+
+	if constexpr ( use_packed_v<T> )
+	{
+		size_t numValues = 0;
+		if ( auto err = read_packed_length<T>( b, numValues ) )
+			return err;
+
+		// Copied in chunks of data already in the buffer, so streams do not need the whole array in their window and
+		// the length is not trusted beyond the data (memory buffers hold it all, so they copy it at once)
+		value.clear();
+		while ( value.size() < numValues )
+		{
+			size_t numChunk = ( b.size() - b.tell() ) / sizeof( T );
+			if ( numChunk > numValues - value.size() )
+				numChunk = numValues - value.size();
+			else if ( numChunk == 0 )
+				numChunk = 1;
+
+			const void *values = b.acquire( numChunk * sizeof( T ) );
+			if ( auto err = b.valid() )
+				return err;
+
+			size_t numRead = value.size();
+			value.resize( numRead + numChunk );
+			copy_wire_order( value.data() + numRead, values, numChunk );
+		}
+
+		return b.valid();
+	}
+
+	size_t numValues = 0;
+	if ( auto err = read_array_length( b, numValues ) )
+		return err;
+
+	// Existing elements are decoded into, so their nested strings and containers keep their memory
+	value.resize( numValues );
+	for ( auto &element : value )
+	{
+		if ( auto err = read( b, element ) )
+			return err;
+	}
+
+	return b.valid();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename A>
+struct layout_of<std::vector<T, A>>
+{
+	using children = type_list<T>;
+
+	static constexpr layout_node node = use_packed_v<T> ?
+		layout_node{ layout_node::single, 0, nullptr } : layout_node{ layout_node::array, 1, layout_list<T>::nodes };
+};
+#endif
+
+} // namespace sbp::detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(SBP_STL_VECTOR)
+namespace sbp {
+
+// Integer vector stored as a single ext value holding differences between neighbouring values, bit-packed to the
+// smallest width of every block. Sorted sequences (timestamps, sequence numbers, IDs...) take just a few bits per value,
+// differences of unsorted sequences are zig-zag encoded, so they stay small no matter their sign.
+template <typename T, typename A = std::allocator<T>>
+struct delta_vector final : std::vector<T, A>
+{
+	static_assert( std::is_integral_v<T> && !std::is_same_v<T, bool>, "delta_vector<T> requires integer type" );
+
+	using std::vector<T, A>::vector;
+};
+
+} // namespace sbp
+
+namespace sbp::detail {
+
+// Ext type of delta encoded integer arrays
+constexpr int8_t delta_ext_type = 126;
+
+// Number of deltas sharing the same bit width
+constexpr size_t delta_block_size = 128;
+
+// Flags, number of values and the first value (little-endian), followed by blocks of deltas, each block starts with
+// its bit width byte and its deltas are packed in little-endian bit order
+constexpr size_t delta_header_size = 1 + sizeof( uint32_t ) + sizeof( uint64_t );
+
+// Flag set when deltas are zig-zag encoded (values are not sorted)
+constexpr uint8_t delta_zigzag = 1;
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE uint64_t zigzag_encode( uint64_t value ) SBP_NOEXCEPT { return ( value << 1 ) ^ ( 0 - ( value >> 63 ) ); }
+SBP_FORCE_INLINE uint64_t zigzag_decode( uint64_t value ) SBP_NOEXCEPT { return ( value >> 1 ) ^ ( 0 - ( value & 1 ) ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE uint32_t bit_width( uint64_t value ) SBP_NOEXCEPT
+{
+#if defined(SBP_MSVC)
+	unsigned long index = 0;
+	return _BitScanReverse64( &index, value ) ? uint32_t( index + 1 ) : 0;
+#else
+	return value ? uint32_t( 64 - __builtin_clzll( value ) ) : 0;
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE uint64_t load_u64( const uint8_t *data ) SBP_NOEXCEPT
+{
+	uint64_t value;
+	memcpy( &value, data, sizeof( value ) );
+	return value;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Computes deltas of a single block (first is index of the first value the block starts after)
+template <typename T>
+SBP_FORCE_INLINE void delta_block( const T *values, size_t first, size_t numDeltas, bool zigzag, uint64_t *deltas ) SBP_NOEXCEPT
+{
+	// Signed values are sign-extended first, so the differences wrap around exactly like on the decoding side
+	for ( size_t i = 0; i < numDeltas; ++i )
+		deltas[i] = static_cast<uint64_t>( values[first + i + 1] ) - static_cast<uint64_t>( values[first + i] );
+
+	if ( zigzag )
+	{
+		for ( size_t i = 0; i < numDeltas; ++i )
+			deltas[i] = zigzag_encode( deltas[i] );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE uint32_t delta_block_width( const uint64_t *deltas, size_t numDeltas ) SBP_NOEXCEPT
+{
+	uint64_t bits = 0;
+	for ( size_t i = 0; i < numDeltas; ++i )
+		bits |= deltas[i];
+
+	return bit_width( bits );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+inline bool delta_zigzag_needed( const T *values, size_t numValues ) SBP_NOEXCEPT
+{
+	for ( size_t i = 1; i < numValues; ++i )
+	{
+		if ( values[i] < values[i - 1] )
+			return true;
+	}
+
+	return false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+inline size_t delta_payload_size( const T *values, size_t numValues, bool zigzag ) SBP_NOEXCEPT
+{
+	uint64_t deltas[delta_block_size];
+	size_t result = delta_header_size;
+
+	for ( size_t first = 0; first + 1 < numValues; first += delta_block_size )
+	{
+		size_t numDeltas = ( numValues - 1 - first < delta_block_size ) ? ( numValues - 1 - first ) : delta_block_size;
+		delta_block( values, first, numDeltas, zigzag, deltas );
+		result += 1 + ( numDeltas * delta_block_width( deltas, numDeltas ) + 7 ) / 8;
+	}
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename T>
+inline void write_delta( Buffer &b, const T *values, size_t numValues ) SBP_NOEXCEPT
+{
+	static_assert( !host_big_endian, "delta encoding requires little-endian host" );
+
+	// Count is stored in 32 bits, longer vectors are rejected by writing never used header 0xc1 instead, so reading
+	// them fails with corrupted_data rather than decoding truncated data
+	if ( numValues > 0xffffffffu )
+		return b.write( uint8_t( 0xc1 ) );
+
+	bool zigzag = delta_zigzag_needed( values, numValues );
+	write_ext_header( b, delta_ext_type, delta_payload_size( values, numValues, zigzag ) );
+
+	uint8_t header[delta_header_size];
+	auto count = static_cast<uint32_t>( numValues );
+	auto firstValue = numValues ? static_cast<uint64_t>( values[0] ) : 0;
+
+	header[0] = zigzag ? delta_zigzag : 0;
+	memcpy( header + 1, &count, sizeof( count ) );
+	memcpy( header + 1 + sizeof( count ), &firstValue, sizeof( firstValue ) );
+	b.write( header, sizeof( header ) );
+
+	uint64_t deltas[delta_block_size];
+	uint8_t block[1 + delta_block_size * sizeof( uint64_t ) + sizeof( uint64_t )];
+
+	for ( size_t first = 0; first + 1 < numValues; first += delta_block_size )
+	{
+		size_t numDeltas = ( numValues - 1 - first < delta_block_size ) ? ( numValues - 1 - first ) : delta_block_size;
+		delta_block( values, first, numDeltas, zigzag, deltas );
+
+		uint32_t width = delta_block_width( deltas, numDeltas );
+		uint8_t *cursor = block + 1;
+		uint64_t bits = 0;
+		uint32_t numBits = 0;
+
+		block[0] = static_cast<uint8_t>( width );
+
+		if ( width <= 56 )
+		{
+			// Less than a byte is pending before every delta, so it always fits, whole bytes are then stored
+			for ( size_t i = 0; width > 0 && i < numDeltas; ++i )
+			{
+				bits |= deltas[i] << numBits;
+				numBits += width;
+				memcpy( cursor, &bits, sizeof( bits ) );
+
+				cursor += numBits / 8;
+				bits >>= numBits & ~7u;
+				numBits &= 7;
+			}
+		}
+		else
+		{
+			for ( size_t i = 0; i < numDeltas; ++i )
+			{
+				bits |= deltas[i] << numBits;
+
+				if ( numBits + width >= 64 )
+				{
+					memcpy( cursor, &bits, sizeof( bits ) );
+					cursor += sizeof( bits );
+
+					// Bits of the delta, which did not fit
+					bits = numBits ? ( deltas[i] >> ( 64 - numBits ) ) : 0;
+					numBits = numBits + width - 64;
+				}
+				else
+					numBits += width;
+			}
+		}
+
+		memcpy( cursor, &bits, ( numBits + 7 ) / 8 );
+		cursor += ( numBits + 7 ) / 8;
+
+		b.write( block, static_cast<size_t>( cursor - block ) );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Unpacks a single block of deltas and turns them back into values. With AVX2 groups of 4 deltas up to 56 bits wide
+// are decoded at once, the scalar loop decodes the remaining tail of the block, or the whole block when deltas are
+// wider (those might span 9 bytes, so data must be readable 16 bytes past the block).
+inline void decode_delta_block( const uint8_t *data, uint32_t width, size_t numDeltas, bool zigzag, uint64_t &value,
+                                uint64_t *output ) SBP_NOEXCEPT
+{
+	const uint64_t mask = ( width < 64 ) ? ( ( uint64_t( 1 ) << width ) - 1 ) : ~uint64_t( 0 );
+	size_t i = 0;
+
+#if defined(__AVX2__)
+	if ( width <= 56 )
+	{
+		const __m256i steps = _mm256_setr_epi64x( 0, width, 2 * width, 3 * width );
+		const __m256i masks = _mm256_set1_epi64x( static_cast<long long>( mask ) );
+		const __m256i sevens = _mm256_set1_epi64x( 7 );
+		const __m256i ones = _mm256_set1_epi64x( 1 );
+		const __m256i zero = _mm256_setzero_si256();
+		__m256i carry = _mm256_set1_epi64x( static_cast<long long>( value ) );
+
+		for ( ; i + 4 <= numDeltas; i += 4 )
+		{
+			// Every lane loads 8 bytes containing its delta and shifts it down
+			__m256i bits = _mm256_add_epi64( _mm256_set1_epi64x( static_cast<long long>( i * width ) ), steps );
+			__m256i deltas = _mm256_i64gather_epi64( reinterpret_cast<const long long *>( data ), _mm256_srli_epi64( bits, 3 ), 1 );
+			deltas = _mm256_and_si256( _mm256_srlv_epi64( deltas, _mm256_and_si256( bits, sevens ) ), masks );
+
+			if ( zigzag )
+				deltas = _mm256_xor_si256( _mm256_srli_epi64( deltas, 1 ), _mm256_sub_epi64( zero, _mm256_and_si256( deltas, ones ) ) );
+
+			// Prefix sum of 4 lanes, then the last value of the previous group is added
+			deltas = _mm256_add_epi64( deltas, _mm256_blend_epi32( _mm256_permute4x64_epi64( deltas, 0x90 ), zero, 0x03 ) );
+			deltas = _mm256_add_epi64( deltas, _mm256_blend_epi32( _mm256_permute4x64_epi64( deltas, 0x40 ), zero, 0x0f ) );
+			deltas = _mm256_add_epi64( deltas, carry );
+
+			_mm256_storeu_si256( reinterpret_cast<__m256i *>( output + i ), deltas );
+			carry = _mm256_permute4x64_epi64( deltas, 0xff );
+		}
+
+		if ( i > 0 )
+			value = output[i - 1];
+	}
+#endif
+
+	for ( ; i < numDeltas; ++i )
+	{
+		size_t bit = i * width;
+		uint64_t delta = load_u64( data + bit / 8 ) >> ( bit % 8 );
+
+		// Widths above 56 bits might not fit into a single load
+		if ( width > 56 && bit % 8 )
+			delta |= load_u64( data + bit / 8 + 8 ) << ( 64 - bit % 8 );
+
+		delta &= mask;
+		value += zigzag ? zigzag_decode( delta ) : delta;
+		output[i] = value;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+inline error decode_delta( const uint8_t *data, size_t numBytes, T *values, size_t numValues, bool zigzag ) SBP_NOEXCEPT
+{
+	uint64_t decoded[delta_block_size];
+	uint8_t block[1 + delta_block_size * sizeof( uint64_t ) + 16];
+
+	const uint8_t *cursor = data + delta_header_size;
+	const uint8_t *end = data + numBytes;
+	uint64_t value = load_u64( data + 1 + sizeof( uint32_t ) );
+
+	if ( numValues > 0 )
+		values[0] = static_cast<T>( value );
+
+	for ( size_t first = 0; first + 1 < numValues; first += delta_block_size )
+	{
+		size_t numDeltas = ( numValues - 1 - first < delta_block_size ) ? ( numValues - 1 - first ) : delta_block_size;
+		if ( cursor >= end || *cursor > 64 )
+			return { error::corrupted_data };
+
+		uint32_t width = *cursor++;
+		size_t blockSize = ( numDeltas * width + 7 ) / 8;
+		if ( blockSize > static_cast<size_t>( end - cursor ) )
+			return { error::corrupted_data };
+
+		// Copied with zero padding, so the decoder can load whole words without checking for the end
+		memcpy( block, cursor, blockSize );
+		memset( block + blockSize, 0, 16 );
+		cursor += blockSize;
+
+		decode_delta_block( block, width, numDeltas, zigzag, value, decoded );
+
+		for ( size_t i = 0; i < numDeltas; ++i )
+			values[first + 1 + i] = static_cast<T>( decoded[i] );
+	}
+
+	return ( cursor == end ) ? error() : error{ error::corrupted_data };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename T, typename A>
+SBP_FORCE_INLINE void write( Buffer &b, const delta_vector<T, A> &value ) SBP_NOEXCEPT { write_delta( b, value.data(), value.size() ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename A>
+SBP_FORCE_INLINE size_t packed_size( size_tag, const delta_vector<T, A> &value ) SBP_NOEXCEPT
+{
+	// Rejected by write_delta
+	if ( value.size() > 0xffffffffu )
+		return 1;
+
+	auto numBytes = delta_payload_size( value.data(), value.size(), delta_zigzag_needed( value.data(), value.size() ) );
+	return ext_header_size( numBytes ) + numBytes;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename A>
+SBP_FORCE_INLINE size_t max_packed_size( size_tag, const delta_vector<T, A> &value ) SBP_NOEXCEPT
+{
+	// Every block might need the full width
+	auto numBlocks = ( value.size() + delta_block_size - 1 ) / delta_block_size;
+	return 6 + delta_header_size + numBlocks + value.size() * sizeof( uint64_t );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename A>
+inline error read( buffer &b, delta_vector<T, A> &value ) SBP_NOEXCEPT
+{
+	bind_resource( value );
+
+	int8_t type = 0;
+	const void *data = nullptr;
+	size_t numBytes = 0;
+
+	if ( auto err = read_ext( b, type, data, numBytes ) )
+		return err;
+
+	if ( type != delta_ext_type || numBytes < delta_header_size )
+		return { error::corrupted_data };
+
+	auto *payload = static_cast<const uint8_t *>( data );
+	uint32_t numValues = 0;
+	memcpy( &numValues, payload + 1, sizeof( numValues ) );
+
+	// Every delta takes at least one bit of its block, anything else cannot be trusted to allocate
+	if ( numValues > 1 && ( numValues - 1 ) / delta_block_size > numBytes )
+		return { error::corrupted_data };
+
+	value.resize( numValues );
+	return decode_delta( payload, numBytes, value.data(), numValues, ( payload[0] & delta_zigzag ) != 0 );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename A>
+struct layout_of<delta_vector<T, A>> { static constexpr layout_node node = { layout_node::single, 0, nullptr }; };
+
+} // namespace sbp::detail
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(SBP_STL_STRING_VIEW) && defined(SBP_STL_VECTOR)
+namespace sbp {
+
+// Strings defined so far by a batch written through interning_writer. Attach it to the buffer the batch is read from
+// (buffer::use_strings), views point directly into buffer memory, so the whole batch must stay in memory while they
+// are used. Clear it whenever the writer is reset.
+class string_table final
+{
+public:
+	size_t size() const SBP_NOEXCEPT { return _strings.size(); }
+
+	std::string_view operator[]( size_t id ) const SBP_NOEXCEPT { return _strings[id]; }
+
+	void clear() SBP_NOEXCEPT { _strings.clear(); }
+
+	void add( std::string_view value ) { _strings.push_back( value ); }
+
+private:
+	std::vector<std::string_view> _strings;
+};
+
+} // namespace sbp
+
+namespace sbp::detail {
+
+// Ext type of the first occurrence of an interned string, payload are the string bytes
+constexpr int8_t string_definition_type = 125;
+
+// Ext type of later occurrences, payload is 1, 2 or 4 byte ID (index of the definition within the batch)
+constexpr int8_t string_reference_type = 124;
+
+// Shorter strings are always written in full, reference would not be any smaller
+constexpr size_t min_interned_length = 4;
+
+//---------------------------------------------------------------------------------------------------------------------
+inline uint32_t hash_bytes( const char *data, size_t length ) SBP_NOEXCEPT
+{
+	constexpr uint64_t multiplier = 0x9e3779b97f4a7c15ull;
+
+	auto *cursor = reinterpret_cast<const uint8_t *>( data );
+	auto *end = cursor + length;
+	uint64_t hash = length * multiplier;
+
+	auto mix = [&hash]( uint64_t value )
+	{
+		hash = ( hash ^ value ) * multiplier;
+		hash ^= hash >> 29;
+	};
+
+	// Tail is loaded by overlapping loads, so short strings take no loop or variable-length copy
+	if ( length >= sizeof( uint64_t ) )
+	{
+		for ( ; end - cursor > 8; cursor += 8 )
+			mix( load_u64( cursor ) );
+
+		mix( load_u64( end - 8 ) );
+	}
+	else if ( length >= sizeof( uint32_t ) )
+	{
+		uint32_t head, tail;
+		memcpy( &head, cursor, sizeof( head ) );
+		memcpy( &tail, end - 4, sizeof( tail ) );
+		mix( head | ( uint64_t( tail ) << 32 ) );
+	}
+	else if ( length > 0 )
+		mix( cursor[0] | ( cursor[length / 2] << 8 ) | ( end[-1] << 16 ) );
+
+	return uint32_t( hash >> 32 );
+}
+
+// Open addressing hash set of strings written so far, assigning consecutive IDs in order of insertion. String bytes
+// are copied, so callers do not need to keep them alive.
+class string_dictionary final
+{
+public:
+	// Returns ID of the string, inserted is set when it was not in the dictionary yet
+	uint32_t insert( const char *data, size_t length, bool &inserted );
+
+	void clear() SBP_NOEXCEPT;
+
+private:
+	struct entry final
+	{
+		size_t offset;
+		size_t length;
+		uint32_t hash;
+	};
+
+	void rehash( size_t numSlots );
+
+	std::vector<entry> _entries;
+
+	// ID + 1 of the entry, zero when the slot is empty
+	std::vector<uint32_t> _slots;
+
+	buffer _storage;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+inline uint32_t string_dictionary::insert( const char *data, size_t length, bool &inserted )
+{
+	// Keep load factor below one half, so probe sequences stay short
+	if ( ( _entries.size() + 1 ) * 2 > _slots.size() )
+		rehash( _slots.empty() ? 256 : _slots.size() * 2 );
+
+	auto hash = hash_bytes( data, length );
+	auto mask = _slots.size() - 1;
+
+	for ( auto slot = hash & mask;; slot = ( slot + 1 ) & mask )
+	{
+		auto id = _slots[slot];
+		if ( id == 0 )
+		{
+			id = static_cast<uint32_t>( _entries.size() );
+			_entries.push_back( { _storage.size(), length, hash } );
+			_storage.write( data, length );
+			_slots[slot] = id + 1;
+
+			inserted = true;
+			return id;
+		}
+
+		const auto &e = _entries[id - 1];
+		if ( e.hash == hash && e.length == length && memcmp( _storage.data() + e.offset, data, length ) == 0 )
+		{
+			inserted = false;
+			return id - 1;
+		}
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void string_dictionary::clear() SBP_NOEXCEPT
+{
+	// Memory is kept for the next batch
+	_entries.clear();
+	_slots.assign( _slots.size(), 0u );
+	_storage.reset( false );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void string_dictionary::rehash( size_t numSlots )
+{
+	_slots.assign( numSlots, 0u );
+	auto mask = numSlots - 1;
+
+	for ( size_t i = 0; i < _entries.size(); ++i )
+	{
+		auto slot = _entries[i].hash & mask;
+		while ( _slots[slot] )
+			slot = ( slot + 1 ) & mask;
+
+		_slots[slot] = static_cast<uint32_t>( i + 1 );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error read_interned( buffer &b, std::string_view &value ) SBP_NOEXCEPT
+{
+	// Table keeps views of defined strings, which refilling the buffer would leave dangling
+	if ( b.has_source() )
+		return { error::corrupted_data };
+
+	// Plain strings are read as usual (header cannot be peeked when nothing is buffered, reading it reports the error)
+	if ( b.tell() >= b.size() || header_infos.entries[b.data()[b.tell()]].family != header_info::ext )
+	{
+		size_t length = 0;
+		if ( auto err = read_string_length( b, length ) )
+			return err;
+
+		value = std::string_view( reinterpret_cast<const char *>( b.acquire( length ) ), length );
+		return b.valid();
+	}
+
+	int8_t type = 0;
+	const void *data = nullptr;
+	size_t numBytes = 0;
+
+	if ( auto err = read_ext( b, type, data, numBytes ) )
+		return err;
+
+	auto &strings = *b.strings();
+
+	if ( type == string_definition_type )
+	{
+		value = std::string_view( static_cast<const char *>( data ), numBytes );
+		strings.add( value );
+		return { error::none };
+	}
+
+	if ( type != string_reference_type )
+		return { error::corrupted_data };
+
+	uint32_t id = 0;
+	switch ( numBytes )
+	{
+		case 1: id = *static_cast<const uint8_t *>( data ); break;
+		case 2: { uint16_t id16; memcpy( &id16, data, sizeof( id16 ) ); id = wire_order( id16 ); } break;
+		case 4: memcpy( &id, data, sizeof( id ) ); id = wire_order( id ); break;
+		default: return { error::corrupted_data };
+	}
+
+	if ( id >= strings.size() )
+		return { error::corrupted_data };
+
+	value = strings[id];
+	return { error::none };
+}
+
+} // namespace sbp::detail
+
+namespace sbp {
+
+// Writes messages into output, interning strings on the way: the first occurrence of a string is written in full and
+// gets the next ID, later occurrences are written as short references to the ID. Strings are interned until reset,
+// so a batch written between resets must be read in order by a buffer with a string_table attached.
+template <typename Buffer>
+class interning_writer final : detail::adl_base
+{
+public:
+	explicit interning_writer( Buffer &output ) SBP_NOEXCEPT : _output( output ) { }
+
+	interning_writer( const interning_writer & ) = delete;
+
+	interning_writer &operator=( const interning_writer & ) = delete;
+
+	Buffer &output() const SBP_NOEXCEPT { return _output; }
+
+	// Starts a new batch, strings written before are not referenced anymore
+	void reset() SBP_NOEXCEPT { _strings.clear(); }
+
+	void write( const void *data, size_t numBytes ) SBP_NOEXCEPT { _output.write( data, numBytes ); }
+
+	template <size_t NumBytes> void write( const void *data ) SBP_NOEXCEPT { _output.template write<NumBytes>( data ); }
+
+	template <typename T> void write( T &&value ) SBP_NOEXCEPT { _output.write( std::forward<T>( value ) ); }
+
+	template <typename T> void write( uint8_t header, T &&value ) SBP_NOEXCEPT { _output.write( header, std::forward<T>( value ) ); }
+
+	void write_string( const char *data, size_t length ) SBP_NOEXCEPT;
+
+private:
+	Buffer &_output;
+	detail::string_dictionary _strings;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer>
+inline void interning_writer<Buffer>::write_string( const char *data, size_t length ) SBP_NOEXCEPT
+{
+	if ( length < detail::min_interned_length )
+		return detail::write_str( _output, data, length );
+
+	bool inserted = false;
+	auto id = _strings.insert( data, length, inserted );
+
+	if ( inserted )
+		detail::write_ext( _output, detail::string_definition_type, data, length );
+	else if ( id <= 0xffu )
+	{
+		auto shortID = uint8_t( id );
+		detail::write_ext<1>( _output, detail::string_reference_type, &shortID );
+	}
+	else if ( id <= 0xffffu )
+	{
+		auto wireID = detail::wire_order( uint16_t( id ) );
+		detail::write_ext<2>( _output, detail::string_reference_type, &wireID );
+	}
+	else
+	{
+		auto wireID = detail::wire_order( id );
+		detail::write_ext<4>( _output, detail::string_reference_type, &wireID );
+	}
+}
+
+} // namespace sbp
+
+namespace sbp::detail {
+
+#if defined(SBP_STL_STRING)
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename Tr, typename A>
+SBP_FORCE_INLINE void write( interning_writer<Buffer> &b, const std::basic_string<char, Tr, A> &value ) SBP_NOEXCEPT
+{
+	b.write_string( value.data(), value.length() );
+}
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer>
+SBP_FORCE_INLINE void write( interning_writer<Buffer> &b, std::string_view value ) SBP_NOEXCEPT { b.write_string( value.data(), value.length() ); }
+
+} // namespace sbp::detail
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(SBP_STL_VECTOR)
+namespace sbp {
+
+// Vector of structs stored column by column: array holding a column per struct member, each column holds the member
+// of all elements. Arithmetic and enum members are stored as packed blobs (compress well, decode with a single pass),
+// other members as arrays. Use read_column to decode a single column without touching the others.
+template <typename T, typename A = std::allocator<T>>
+struct column_vector final : std::vector<T, A>
+{
+	static_assert( std::is_class_v<T> && std::is_aggregate_v<T> && !detail::is_extension_v<T>, "column_vector<T> requires struct type" );
+
+	using std::vector<T, A>::vector;
+};
+
+} // namespace sbp
+
+namespace sbp::detail {
+
+// Enums are stored as their underlying type
+template <typename M, bool = std::is_enum_v<M>>
+struct column_value { using type = M; };
+
+template <typename M>
+struct column_value<M, true> { using type = std::underlying_type_t<M>; };
+
+template <typename M>
+using column_value_t = typename column_value<M>::type;
+
+template <typename M>
+constexpr bool is_packed_column_v = is_packable_v<column_value_t<M>>;
+
+// Type with the same encoding as a column of member type M
+template <typename M>
+using column_t = std::conditional_t<is_packed_column_v<M>, packed_view<column_value_t<M>>, std::vector<M>>;
+
+template <typename... M>
+constexpr size_t num_types( type_list<M...> ) SBP_NOEXCEPT { return sizeof...( M ); }
+
+template <typename T>
+constexpr size_t num_members_v = num_types( member_types_t<T>() );
+
+template <size_t Index, typename T>
+using member_type_t = std::remove_cv_t<std::remove_reference_t<decltype( member_at<Index>( std::declval<T &>() ) )>>;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Copies member at Index of numValues structs into wire order values of the column, output may be unaligned
+template <size_t Index, typename T>
+SBP_FORCE_INLINE void gather_column( uint8_t *output, const T *values, size_t numValues ) SBP_NOEXCEPT
+{
+	using C = column_value_t<member_type_t<Index, T>>;
+
+	for ( size_t i = 0; i < numValues; ++i )
+	{
+		auto value = C( member_at<Index>( values[i] ) );
+
+		if constexpr ( std::is_arithmetic_v<C> )
+			value = wire_order( value );
+
+		memcpy( output + i * sizeof( C ), &value, sizeof( C ) );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <size_t Index, typename Buffer, typename T>
+SBP_FORCE_INLINE void write_column( Buffer &b, const T *values, size_t numValues ) SBP_NOEXCEPT
+{
+	using M = member_type_t<Index, T>;
+	using C = column_value_t<M>;
+
+	if constexpr ( is_packed_column_v<M> )
+	{
+		write_packed_header<Buffer, C>( b, numValues );
+
+		if constexpr ( std::is_base_of_v<buffer, Buffer> )
+		{
+			uint8_t *output = b.prepare_write( numValues * sizeof( C ) );
+			gather_column<Index>( output, values, numValues );
+			b.commit_write( output + numValues * sizeof( C ) );
+		}
+		else
+		{
+			// Other writers get the column in chunks small enough to stay in L1 cache
+			constexpr size_t chunkSize = ( sizeof( C ) < 4096 ) ? 4096 / sizeof( C ) : 1;
+			uint8_t chunk[chunkSize * sizeof( C )];
+
+			for ( size_t i = 0; i < numValues; i += chunkSize )
+			{
+				size_t numChunkValues = ( numValues - i < chunkSize ) ? ( numValues - i ) : chunkSize;
+				gather_column<Index>( chunk, values + i, numChunkValues );
+				b.write( chunk, numChunkValues * sizeof( C ) );
+			}
+		}
+	}
+	else
+	{
+		write_array_header( b, numValues );
+
+		for ( size_t i = 0; i < numValues; ++i )
+			write_multiple( b, member_at<Index>( values[i] ) );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename T, size_t... Indices>
+SBP_FORCE_INLINE void write_columns( Buffer &b, const T *values, size_t numValues, std::index_sequence<Indices...> ) SBP_NOEXCEPT
+{
+	write_array_header( b, sizeof...( Indices ) );
+	( write_column<Indices>( b, values, numValues ), ... );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <size_t Index, typename T>
+SBP_FORCE_INLINE size_t packed_size_column( const T *values, size_t numValues ) SBP_NOEXCEPT
+{
+	using M = member_type_t<Index, T>;
+
+	if constexpr ( is_packed_column_v<M> )
+		return packed_size_packed<column_value_t<M>>( numValues );
+	else
+	{
+		auto result = array_header_size( numValues );
+
+		for ( size_t i = 0; i < numValues; ++i )
+			result += packed_size( size_tag(), member_at<Index>( values[i] ) );
+
+		return result;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <size_t Index, typename T>
+SBP_FORCE_INLINE size_t max_packed_size_column( const T *values, size_t numValues ) SBP_NOEXCEPT
+{
+	using M = member_type_t<Index, T>;
+
+	if constexpr ( is_packed_column_v<M> )
+		return packed_size_packed<column_value_t<M>>( numValues );
+	else if constexpr ( max_size_of<M>() != variable_size )
+		return 5 + numValues * max_size_of<M>();
+	else
+	{
+		size_t result = 5;
+
+		for ( size_t i = 0; i < numValues; ++i )
+			result += max_packed_size( size_tag(), member_at<Index>( values[i] ) );
+
+		return result;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, size_t... Indices>
+SBP_FORCE_INLINE size_t packed_size_columns( const T *values, size_t numValues, std::index_sequence<Indices...> ) SBP_NOEXCEPT
+{
+	return array_header_size( sizeof...( Indices ) ) + ( packed_size_column<Indices>( values, numValues ) + ... + 0 );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, size_t... Indices>
+SBP_FORCE_INLINE size_t max_packed_size_columns( const T *values, size_t numValues, std::index_sequence<Indices...> ) SBP_NOEXCEPT
+{
+	return array_header_size( sizeof...( Indices ) ) + ( max_packed_size_column<Indices>( values, numValues ) + ... + 0 );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Reads column at Index into members of value elements, the first column decides number of elements
+template <size_t Index, typename T, typename A>
+SBP_FORCE_INLINE error read_column_into( buffer &b, std::vector<T, A> &value ) SBP_NOEXCEPT
+{
+	using M = member_type_t<Index, T>;
+	using C = column_value_t<M>;
+
+	size_t numValues = 0;
+	const C *columnValues = nullptr;
+
+	if constexpr ( is_packed_column_v<M> )
+	{
+		if ( auto err = read_packed( b, columnValues, numValues ) )
+			return err;
+	}
+	else
+	{
+		if ( auto err = read_array_length( b, numValues ) )
+			return err;
+	}
+
+	// Packed column is already in the buffer, array column members take at least a byte each
+	if constexpr ( Index == 0 && is_packed_column_v<M> )
+		value.resize( numValues );
+	else if constexpr ( Index == 0 )
+		resize_readable( b, value, numValues, 1 );
+	else if ( numValues != value.size() )
+		return { error::corrupted_data };
+
+	if constexpr ( is_packed_column_v<M> )
+	{
+		auto *elements = value.data();
+
+		for ( size_t i = 0; i < numValues; ++i )
+		{
+			C columnValue;
+			memcpy( &columnValue, columnValues + i, sizeof( C ) );
+
+			if constexpr ( std::is_arithmetic_v<C> )
+				columnValue = wire_order( columnValue );
+
+			member_at<Index>( elements[i] ) = static_cast<M>( columnValue );
+		}
+
+		return b.valid();
+	}
+	else
+	{
+		for ( size_t i = 0; i < numValues; ++i )
+		{
+			if ( i == value.size() )
+				value.emplace_back();
+
+			if ( auto err = read_multiple( b, member_at<Index>( value[i] ) ) )
+				return err;
+		}
+
+		return b.valid();
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename A, size_t... Indices>
+SBP_FORCE_INLINE error read_columns( buffer &b, std::vector<T, A> &value, std::index_sequence<Indices...> ) SBP_NOEXCEPT
+{
+	size_t numColumns = 0;
+	if ( auto err = read_array_length( b, numColumns ) )
+		return err;
+
+	if ( numColumns != sizeof...( Indices ) )
+		return { error::corrupted_data };
+
+	// Stops at the first error
+	error err;
+	( ( err = read_column_into<Indices>( b, value ) ) || ... );
+	return err;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Packed column read into a vector of any type constructible from the member
+template <typename M, typename V, typename A>
+SBP_FORCE_INLINE error read_column_values( buffer &b, std::vector<V, A> &column ) SBP_NOEXCEPT
+{
+	if constexpr ( is_packed_column_v<M> )
+	{
+		using C = column_value_t<M>;
+
+		const C *values = nullptr;
+		size_t numValues = 0;
+		if ( auto err = read_packed( b, values, numValues ) )
+			return err;
+
+		column.resize( numValues );
+		for ( size_t i = 0; i < numValues; ++i )
+		{
+			C value;
+			memcpy( &value, values + i, sizeof( C ) );
+
+			if constexpr ( std::is_arithmetic_v<C> )
+				value = wire_order( value );
+
+			column[i] = static_cast<V>( static_cast<M>( value ) );
+		}
+
+		return b.valid();
+	}
+	else
+		return read( b, column );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Packed column viewed without copying
+template <typename M, typename C>
+SBP_FORCE_INLINE error read_column_values( buffer &b, packed_view<C> &column ) SBP_NOEXCEPT
+{
+	static_assert( std::is_same_v<column_t<M>, packed_view<C>>, "packed_view does not match column type" );
+	return read( b, column );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename T, typename A>
+SBP_FORCE_INLINE void write( Buffer &b, const column_vector<T, A> &value ) SBP_NOEXCEPT
+{
+	write_columns( b, value.data(), value.size(), std::make_index_sequence<num_members_v<T>>() );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename A>
+SBP_FORCE_INLINE size_t packed_size( size_tag, const column_vector<T, A> &value ) SBP_NOEXCEPT
+{
+	return packed_size_columns( value.data(), value.size(), std::make_index_sequence<num_members_v<T>>() );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename A>
+SBP_FORCE_INLINE size_t max_packed_size( size_tag, const column_vector<T, A> &value ) SBP_NOEXCEPT
+{
+	return max_packed_size_columns( value.data(), value.size(), std::make_index_sequence<num_members_v<T>>() );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename A>
+SBP_FORCE_INLINE error read( buffer &b, column_vector<T, A> &value ) SBP_NOEXCEPT
+{
+	bind_resource( value );
+	return read_columns( b, value, std::make_index_sequence<num_members_v<T>>() );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename... M>
+constexpr type_list<column_t<M>...> column_types( type_list<M...> ) SBP_NOEXCEPT { return { }; }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename... C>
+constexpr layout_node tuple_layout( type_list<C...> ) SBP_NOEXCEPT
+{
+	return { layout_node::tuple, uint32_t( sizeof...( C ) ), layout_list<C...>::nodes };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename A>
+struct layout_of<column_vector<T, A>>
+{
+	using children = decltype( column_types( member_types_t<T>() ) );
+
+	static constexpr layout_node node = tuple_layout( children() );
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Skips columns First + Indices of column_vector<T>
+template <typename T, size_t First, size_t... Indices>
+SBP_FORCE_INLINE error skip_columns( buffer &b, std::index_sequence<Indices...> ) SBP_NOEXCEPT
+{
+	error err;
+	( ( err = skip_as<column_t<member_type_t<First + Indices, T>>>( b ) ) || ... );
+	return err;
+}
+
+} // namespace sbp::detail
+
+namespace sbp {
+
+//---------------------------------------------------------------------------------------------------------------------
+// Decodes a single column of column_vector<T> (Index of the member in its structured binding list), other columns are
+// skipped. Packed columns can be viewed without copying (packed_view of the member type, or its underlying type for
+// enums), any column can be read into std::vector of the member type, e.g. sbp::read_column<Trade, 1>( b, prices )
+template <typename T, size_t Index, typename C>
+error read_column( buffer &b, C &column ) SBP_NOEXCEPT
+{
+	static_assert( Index < detail::num_members_v<T>, "column index is out of range" );
+
+	size_t numColumns = 0;
+	if ( auto err = detail::read_array_length( b, numColumns ) )
+		return err;
+
+	if ( numColumns != detail::num_members_v<T> )
+		return { error::corrupted_data };
+
+	if ( auto err = detail::skip_columns<T, 0>( b, std::make_index_sequence<Index>() ) )
+		return err;
+
+	if ( auto err = detail::read_column_values<detail::member_type_t<Index, T>>( b, column ) )
+		return err;
+
+	return detail::skip_columns<T, Index + 1>( b, std::make_index_sequence<detail::num_members_v<T> - Index - 1>() );
+}
+
+} // namespace sbp
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(SBP_STL_VECTOR)
+namespace sbp {
+
+// Map stored as a vector of entries sorted by their keys, stored the same way as std::map. Decoding sorted entries takes
+// a single allocation and linear time, entries in any other order are sorted afterwards (last value of duplicate keys
+// wins). Keep entries sorted when filling the map, lookups use binary search.
+template <typename K, typename T, typename P = std::less<K>, typename A = std::allocator<std::pair<K, T>>>
+struct flat_map final : std::vector<std::pair<K, T>, A>
+{
+	using key_type = K;
+	using mapped_type = T;
+	using key_compare = P;
+
+	using std::vector<std::pair<K, T>, A>::vector;
+
+	auto lower_bound( const K &key ) SBP_NOEXCEPT { return this->begin() + lower_bound_index( key ); }
+
+	auto lower_bound( const K &key ) const SBP_NOEXCEPT { return this->begin() + lower_bound_index( key ); }
+
+	auto find( const K &key ) SBP_NOEXCEPT { return this->begin() + find_index( key ); }
+
+	auto find( const K &key ) const SBP_NOEXCEPT { return this->begin() + find_index( key ); }
+
+	bool contains( const K &key ) const SBP_NOEXCEPT { return find_index( key ) != this->size(); }
+
+private:
+	size_t lower_bound_index( const K &key ) const SBP_NOEXCEPT
+	{
+		const auto *entries = this->data();
+		size_t first = 0;
+		size_t count = this->size();
+
+		while ( count > 0 )
+		{
+			size_t half = count / 2;
+			if ( P()( entries[first + half].first, key ) )
+			{
+				first += half + 1;
+				count -= half + 1;
+			}
+			else
+				count = half;
+		}
+
+		return first;
+	}
+
+	size_t find_index( const K &key ) const SBP_NOEXCEPT
+	{
+		size_t index = lower_bound_index( key );
+		return ( index != this->size() && !P()( key, this->data()[index].first ) ) ? index : this->size();
+	}
+};
+
+} // namespace sbp
+
+namespace sbp::detail {
+
+//---------------------------------------------------------------------------------------------------------------------
+// Sorts entries by merging sorted runs of growing width (keeps the order of duplicate keys), then drops all but the
+// last of duplicate keys
+template <typename K, typename T, typename P, typename A>
+SBP_NOINLINE void sort_flat_map( flat_map<K, T, P, A> &value ) SBP_NOEXCEPT
+{
+	size_t numValues = value.size();
+
+	flat_map<K, T, P, A> temp( value.get_allocator() );
+	temp.resize( numValues );
+
+	auto *source = value.data();
+	auto *target = temp.data();
+
+	for ( size_t width = 1; width < numValues; width *= 2 )
+	{
+		for ( size_t begin = 0; begin < numValues; begin += 2 * width )
+		{
+			size_t middle = ( begin + width < numValues ) ? begin + width : numValues;
+			size_t end = ( middle + width < numValues ) ? middle + width : numValues;
+			size_t left = begin;
+			size_t right = middle;
+
+			for ( size_t i = begin; i < end; ++i )
+			{
+				if ( left < middle && ( right == end || !P()( source[right].first, source[left].first ) ) )
+					target[i] = std::move( source[left++] );
+				else
+					target[i] = std::move( source[right++] );
+			}
+		}
+
+		auto *swapped = source;
+		source = target;
+		target = swapped;
+	}
+
+	if ( source != value.data() )
+		value.swap( temp );
+
+	size_t numUnique = 0;
+	for ( size_t i = 0; i < numValues; ++i )
+	{
+		if ( i + 1 < numValues && !P()( value[i].first, value[i + 1].first ) )
+			continue;
+
+		if ( numUnique != i )
+			value[numUnique] = std::move( value[i] );
+
+		++numUnique;
+	}
+
+	value.resize( numUnique );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename K, typename T, typename P, typename A>
+SBP_FORCE_INLINE void write( Buffer &b, const flat_map<K, T, P, A> &value ) SBP_NOEXCEPT { write_map( b, value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename K, typename T, typename P, typename A>
+SBP_FORCE_INLINE size_t packed_size( size_tag, const flat_map<K, T, P, A> &value ) SBP_NOEXCEPT { return packed_size_map( value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename K, typename T, typename P, typename A>
+SBP_FORCE_INLINE size_t max_packed_size( size_tag, const flat_map<K, T, P, A> &value ) SBP_NOEXCEPT { return max_packed_size_map( value ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename K, typename T, typename P, typename A>
+inline error read( buffer &b, flat_map<K, T, P, A> &value ) SBP_NOEXCEPT
+{
+	bind_resource( value );
+
+	size_t numValues = 0;
+	if ( auto err = read_map_length( b, numValues ) )
+		return err;
+
+	// Existing entries are decoded into, like elements of vectors (every entry takes at least two bytes)
+	resize_readable( b, value, numValues, 2 );
+
+	bool sorted = true;
+	for ( size_t i = 0; i < numValues; ++i )
+	{
+		if ( i == value.size() )
+			value.emplace_back();
+
+		auto &entry = value[i];
+		if ( auto err = read( b, entry.first ) )
+			return err;
+
+		if ( auto err = read( b, entry.second ) )
+			return err;
+
+		if ( i > 0 && !P()( value[i - 1].first, entry.first ) )
+			sorted = false;
+	}
+
+	if ( !sorted )
+		sort_flat_map( value );
+
+	return b.valid();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename K, typename T, typename P, typename A>
+struct layout_of<flat_map<K, T, P, A>>
+{
+	using children = type_list<K, T>;
+
+	static constexpr layout_node node = { layout_node::map, 2, layout_list<K, T>::nodes };
+};
+
+} // namespace sbp::detail
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(SBP_STL_MEMORY_RESOURCE)
+namespace sbp {
+
+// Monotonic memory resource for decoding messages with std::pmr containers: memory is handed out linearly from large
+// blocks, deallocation does nothing and release frees everything at once. Blocks are kept (merged into a single one),
+// so decoding similar messages over and over stops allocating anything once the arena has grown large enough.
+class arena final : public std::pmr::memory_resource
+{
+public:
+	static constexpr size_t default_block_size = 64 * 1024;
+
+	explicit arena( size_t blockSize = default_block_size ) SBP_NOEXCEPT : _blockSize( blockSize ) { }
+
+	arena( const arena & ) = delete;
+
+	~arena() { free_blocks(); }
+
+	arena &operator=( const arena & ) = delete;
+
+	// Frees all memory handed out so far at once, containers using it must be destroyed before (decode the next message
+	// into a new object)
+	void release() SBP_NOEXCEPT;
+
+	// Number of bytes handed out since the last release
+	size_t size() const SBP_NOEXCEPT { return _usedSize + static_cast<size_t>( _cursor - _begin ); }
+
+	// Number of bytes allocated from the system
+	size_t capacity() const SBP_NOEXCEPT { return _capacity; }
+
+private:
+	struct block final
+	{
+		block *next;
+		size_t size;
+	};
+
+	void *do_allocate( size_t numBytes, size_t alignment ) override;
+
+	void do_deallocate( void *, size_t, size_t ) override { }
+
+	bool do_is_equal( const std::pmr::memory_resource &other ) const noexcept override { return this == &other; }
+
+	void add_block( size_t minSize ) SBP_NOEXCEPT;
+
+	void free_blocks() SBP_NOEXCEPT;
+
+	// Most recent block is the first one
+	block *_blocks = nullptr;
+	uint8_t *_begin = nullptr;
+	uint8_t *_cursor = nullptr;
+	uint8_t *_end = nullptr;
+
+	// Bytes handed out from older blocks (including space wasted at their ends)
+	size_t _usedSize = 0;
+	size_t _capacity = 0;
+	size_t _blockSize = default_block_size;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void *arena::do_allocate( size_t numBytes, size_t alignment )
+{
+	auto address = reinterpret_cast<uintptr_t>( _cursor );
+	auto padding = ( alignment - address % alignment ) % alignment;
+
+	if ( !_cursor || numBytes + padding > static_cast<size_t>( _end - _cursor ) )
+	{
+		add_block( numBytes + alignment );
+
+		address = reinterpret_cast<uintptr_t>( _cursor );
+		padding = ( alignment - address % alignment ) % alignment;
+	}
+
+	void *result = _cursor + padding;
+	_cursor += padding + numBytes;
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void arena::add_block( size_t minSize ) SBP_NOEXCEPT
+{
+	if ( _blocks )
+		_usedSize += static_cast<size_t>( _cursor - _begin );
+
+	// Blocks grow geometrically, so large messages need just a few of them
+	size_t size = ( _capacity > _blockSize ) ? _capacity : _blockSize;
+	if ( size < minSize )
+		size = minSize;
+
+	auto *memory = new uint8_t[sizeof( block ) + size];
+	_blocks = new ( memory ) block{ _blocks, size };
+	_capacity += size;
+
+	_begin = _cursor = memory + sizeof( block );
+	_end = _begin + size;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void arena::release() SBP_NOEXCEPT
+{
+	// Several blocks are merged into one, which holds everything the next time
+	if ( _blocks && _blocks->next )
+	{
+		auto capacity = _capacity;
+		free_blocks();
+		add_block( capacity );
+	}
+
+	_cursor = _begin;
+	_usedSize = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void arena::free_blocks() SBP_NOEXCEPT
+{
+	while ( _blocks )
+	{
+		auto *next = _blocks->next;
+		delete[] reinterpret_cast<uint8_t *>( _blocks );
+		_blocks = next;
+	}
+
+	_begin = _cursor = _end = nullptr;
+	_usedSize = 0;
+	_capacity = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Decodes message with std::pmr containers allocating from given memory resource (typically sbp::arena). Containers
+// using a different resource are emptied and rebuilt with it first, nested containers then inherit it from their parent.
+template <typename T>
+error read( buffer &b, T &msg, std::pmr::memory_resource *resource ) SBP_NOEXCEPT
+{
+	auto *previous = detail::bound_resource;
+	detail::bound_resource = resource;
+
+	auto err = read( b, msg );
+
+	detail::bound_resource = previous;
+	return err;
+}
+
+} // namespace sbp
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace sbp {
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer, typename T>
+void write( Buffer &b, const T &msg ) SBP_NOEXCEPT
+{
+	if constexpr ( detail::has_n_members_v<T, 10> )
+	{
+		const auto &[m0, m1, m2, m3, m4, m5, m6, m7, m8, m9] = msg;
+		detail::write_multiple( b, m0, m1, m2, m3, m4, m5, m6, m7, m8, m9 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 9> )
+	{
+		const auto &[m0, m1, m2, m3, m4, m5, m6, m7, m8] = msg;
+		detail::write_multiple( b, m0, m1, m2, m3, m4, m5, m6, m7, m8 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 8> )
+	{
+		const auto &[m0, m1, m2, m3, m4, m5, m6, m7] = msg;
+		detail::write_multiple( b, m0, m1, m2, m3, m4, m5, m6, m7 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 7> )
+	{
+		const auto &[m0, m1, m2, m3, m4, m5, m6] = msg;
+		detail::write_multiple( b, m0, m1, m2, m3, m4, m5, m6 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 6> )
+	{
+		const auto &[m0, m1, m2, m3, m4, m5] = msg;
+		detail::write_multiple( b, m0, m1, m2, m3, m4, m5 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 5> )
+	{
+		const auto &[m0, m1, m2, m3, m4] = msg;
+		detail::write_multiple( b, m0, m1, m2, m3, m4 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 4> )
+	{
+		const auto &[m0, m1, m2, m3] = msg;
+		detail::write_multiple( b, m0, m1, m2, m3 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 3> )
+	{
+		const auto &[m0, m1, m2] = msg;
+		detail::write_multiple( b, m0, m1, m2 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 2> )
+	{
+		const auto &[m0, m1] = msg;
+		detail::write_multiple( b, m0, m1 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 1> )
+	{
+		const auto &[m0] = msg;
+		detail::write_multiple( b, m0 );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Returns exact number of bytes sbp::write would produce for this message
+template <typename T>
+size_t packed_size( const T &msg ) SBP_NOEXCEPT { return detail::packed_size( detail::size_tag(), msg ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+// Same as sbp::write, but reserves exact amount of required memory first, so there is at most one reallocation
+template <typename T>
+void write_exact( buffer &b, const T &msg ) SBP_NOEXCEPT
+{
+	b.reserve( b.size() + packed_size( msg ) );
+	write( b, msg );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Returns upper bound of sbp::packed_size, cheaper to compute
+template <typename T>
+size_t max_packed_size( const T &msg ) SBP_NOEXCEPT { return detail::max_packed_size( detail::size_tag(), msg ); }
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+constexpr bool is_fixed_size_v = detail::max_size_of<T>() != detail::variable_size;
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+struct max_packed_size_of
+{
+	static_assert( is_fixed_size_v<T>, "message contains members without compile-time known maximum size" );
+	static constexpr size_t value = detail::max_size_of<T>();
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Compile-time upper bound of sbp::packed_size for messages with fixed-size members only
+template <typename T>
+constexpr size_t max_packed_size_v = max_packed_size_of<T>::value;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Writes fixed-size message into raw memory without any capacity checks, returns number of bytes written
+template <typename T, size_t NumBytes>
+size_t write_fixed( uint8_t( &data )[NumBytes], const T &msg ) SBP_NOEXCEPT
+{
+	static_assert( NumBytes >= max_packed_size_v<T>, "array is too small for this message type" );
+
+	unchecked_writer w( data );
+	write( w, msg );
+	return static_cast<size_t>( w.cursor() - data );
+}
+
+#if defined(SBP_STL_ARRAY)
+//---------------------------------------------------------------------------------------------------------------------
+// Stack array large enough for any instance of the message
+template <typename T>
+using packed_array = std::array<uint8_t, max_packed_size_v<T>>;
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, size_t NumBytes>
+size_t write_fixed( std::array<uint8_t, NumBytes> &data, const T &msg ) SBP_NOEXCEPT
+{
+	static_assert( NumBytes >= max_packed_size_v<T>, "array is too small for this message type" );
+
+	unchecked_writer w( data.data() );
+	write( w, msg );
+	return static_cast<size_t>( w.cursor() - data.data() );
+}
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+// Writes message into caller-provided memory, never allocates. Returns error::buffer_full when the memory is too small,
+// numBytes is then set to the number of bytes required instead of number of bytes written.
+template <typename T>
+error write( void *data, size_t capacity, const T &msg, size_t &numBytes ) SBP_NOEXCEPT
+{
+	span_writer w( data, capacity );
+	write( w, msg );
+	numBytes = w.size();
+	return w.valid();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Same as sbp::write, but checks buffer capacity only once per message (reserves max_packed_size_v bytes). Walking
+// variable-size messages for their bound costs more than the checks it saves, so they are just written by sbp::write.
+template <typename T>
+void write_unchecked( buffer &b, const T &msg ) SBP_NOEXCEPT
+{
+	if constexpr ( is_fixed_size_v<T> )
+	{
+		unchecked_writer w( b.prepare_write( max_packed_size_v<T> ) );
+		write( w, msg );
+		b.commit_write( w.cursor() );
+	}
+	else
+		write( b, msg );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+error read( buffer &b, T &msg ) SBP_NOEXCEPT
+{
+	if constexpr ( detail::has_n_members_v<T, 10> )
+	{
+		auto &[m0, m1, m2, m3, m4, m5, m6, m7, m8, m9] = msg;
+		return detail::read_multiple( b, m0, m1, m2, m3, m4, m5, m6, m7, m8, m9 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 9> )
+	{
+		auto &[m0, m1, m2, m3, m4, m5, m6, m7, m8] = msg;
+		return detail::read_multiple( b, m0, m1, m2, m3, m4, m5, m6, m7, m8 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 8> )
+	{
+		auto &[m0, m1, m2, m3, m4, m5, m6, m7] = msg;
+		return detail::read_multiple( b, m0, m1, m2, m3, m4, m5, m6, m7 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 7> )
+	{
+		auto &[m0, m1, m2, m3, m4, m5, m6] = msg;
+		return detail::read_multiple( b, m0, m1, m2, m3, m4, m5, m6 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 6> )
+	{
+		auto &[m0, m1, m2, m3, m4, m5] = msg;
+		return detail::read_multiple( b, m0, m1, m2, m3, m4, m5 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 5> )
+	{
+		auto &[m0, m1, m2, m3, m4] = msg;
+		return detail::read_multiple( b, m0, m1, m2, m3, m4 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 4> )
+	{
+		auto &[m0, m1, m2, m3] = msg;
+		return detail::read_multiple( b, m0, m1, m2, m3 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 3> )
+	{
+		auto &[m0, m1, m2] = msg;
+		return detail::read_multiple( b, m0, m1, m2 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 2> )
+	{
+		auto &[m0, m1] = msg;
+		return detail::read_multiple( b, m0, m1 );
+	}
+	else if constexpr ( detail::has_n_members_v<T, 1> )
+	{
+		auto &[m0] = msg;
+		return detail::read_multiple( b, m0 );
+	}
+
+	return b.valid();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Decodes only selected members of the message (indices into its structured binding list), all other members are
+// skipped without decoding or allocating anything, e.g. sbp::read_fields<Order, 0, 3>( b, order )
+template <typename T, size_t... Indices>
+error read_fields( buffer &b, T &msg ) SBP_NOEXCEPT
+{
+	return detail::apply_members( msg, [&b]( auto &... members ) SBP_NOEXCEPT
+	{
+		return detail::read_selected<Indices...>( b, std::index_sequence_for<decltype( members )...>(), members... );
+	} );
+}
+
+#if defined(SBP_STL_THREAD) && defined(SBP_STL_VECTOR)
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+// Smaller batches are not worth spawning threads for
+constexpr size_t min_parallel_chunk_size = 4096;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Calls func( taskIndex ) for every task, tasks are spread over numThreads threads (calling thread included)
+template <typename F>
+inline void run_parallel( size_t numTasks, size_t numThreads, const F &func ) SBP_NOEXCEPT
+{
+	if ( numThreads > numTasks )
+		numThreads = numTasks;
+
+	// Interleaved assignment, so uneven tasks are spread evenly
+	auto worker = [numTasks, numThreads, &func]( size_t first )
+	{
+		for ( size_t i = first; i < numTasks; i += numThreads )
+			func( i );
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve( numThreads );
+
+	for ( size_t i = 1; i < numThreads; ++i )
+		threads.emplace_back( worker, i );
+
+	worker( 0 );
+
+	for ( auto &thread : threads )
+		thread.join();
+}
+
+} // namespace detail
+
+//---------------------------------------------------------------------------------------------------------------------
+// Same output as writing the vector member by sbp::write, but elements are encoded on multiple threads. Exact size
+// of every chunk is computed first, then all chunks are written in parallel directly to their final place in the
+// buffer, so nothing has to be copied afterwards.
+template <typename T, typename A>
+void write_parallel( buffer &b, const std::vector<T, A> &values,
+                     size_t numThreads = std::thread::hardware_concurrency() ) SBP_NOEXCEPT
+{
+	auto numChunks = values.size() / detail::min_parallel_chunk_size;
+	if ( numChunks > numThreads * 4 )
+		numChunks = numThreads * 4;
+
+	if ( detail::use_packed_v<T> || numThreads <= 1 || numChunks <= 1 )
+		return detail::write( b, values );
+
+	auto chunkBegin = [&values, numChunks]( size_t chunk ) { return values.size() * chunk / numChunks; };
+
+	// Offset of every chunk in the array
+	std::vector<size_t> offsets( numChunks + 1, 0 );
+	detail::run_parallel( numChunks, numThreads, [&]( size_t chunk ) SBP_NOEXCEPT
+	{
+		size_t size = 0;
+		for ( size_t i = chunkBegin( chunk ), end = chunkBegin( chunk + 1 ); i < end; ++i )
+			size += detail::packed_size( detail::size_tag(), values[i] );
+
+		offsets[chunk + 1] = size;
+	} );
+
+	for ( size_t i = 1; i <= numChunks; ++i )
+		offsets[i] += offsets[i - 1];
+
+	auto headerSize = detail::array_header_size( values.size() );
+	uint8_t *output = b.prepare_write( headerSize + offsets[numChunks] );
+
+	unchecked_writer header( output );
+	detail::write_array_header( header, values.size() );
+
+	detail::run_parallel( numChunks, numThreads, [&]( size_t chunk ) SBP_NOEXCEPT
+	{
+		unchecked_writer w( output + headerSize + offsets[chunk] );
+		for ( size_t i = chunkBegin( chunk ), end = chunkBegin( chunk + 1 ); i < end; ++i )
+			write( w, values[i] );
+	} );
+
+	b.commit_write( output + headerSize + offsets[numChunks] );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Decodes all messages from read cursor to the end of the buffer on multiple threads. Message boundaries are found
+// by skipping messages first (nothing is allocated), then slices of messages are decoded in parallel directly into
+// their final place in the vector.
+template <typename T, typename A>
+error read_parallel( buffer &b, std::vector<T, A> &msgs, size_t numThreads = std::thread::hardware_concurrency() ) SBP_NOEXCEPT
+{
+	static_assert( std::is_class_v<T> && std::is_aggregate_v<T>, "read_parallel requires a struct message type" );
+
+	const uint8_t *data = b.data() + b.tell();
+	size_t size = b.size() - b.tell();
+
+	// Offsets of message boundaries
+	std::vector<size_t> offsets( 1, 0 );
+	buffer view( data, size );
+
+	while ( view.tell() < size )
+	{
+		if ( auto err = detail::skip_as<T>( view ) )
+			return err;
+
+		offsets.push_back( view.tell() );
+	}
+
+	// Existing messages are overwritten, so their memory can be reused
+	auto numMessages = offsets.size() - 1;
+	msgs.resize( numMessages );
+
+	auto numChunks = numMessages / ( detail::min_parallel_chunk_size / 16 );
+	if ( numChunks > numThreads * 4 )
+		numChunks = numThreads * 4;
+
+	if ( numChunks < 1 )
+		numChunks = 1;
+
+	auto chunkBegin = [numMessages, numChunks]( size_t chunk ) { return numMessages * chunk / numChunks; };
+
+	std::vector<error> errors( numChunks );
+	auto decodeChunk = [&]( size_t chunk ) SBP_NOEXCEPT
+	{
+		auto first = chunkBegin( chunk );
+		auto last = chunkBegin( chunk + 1 );
+		buffer view( data + offsets[first], offsets[last] - offsets[first] );
+
+		for ( auto i = first; i < last && !errors[chunk]; ++i )
+			errors[chunk] = read( view, msgs[i] );
+	};
+
+	// Single thread still gets up to 4 chunks, run_parallel decodes all of them on the calling thread
+	if ( numChunks == 1 )
+		decodeChunk( 0 );
+	else
+		detail::run_parallel( numChunks, numThreads, decodeChunk );
+
+	for ( auto err : errors )
+	{
+		if ( err )
+			return err;
+	}
+
+	b.seek( b.tell() + size );
+	return { error::none };
+}
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+// Moves read cursor after a single MessagePack value (nested arrays and maps included) without decoding it. Note that
+// structs are written member by member, so a struct is usually more than one value.
+inline error skip( buffer &b ) SBP_NOEXCEPT { return detail::skip_values( b, 1 ); }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Decodes messages from data arriving in arbitrary pieces (non-blocking sockets...). Append received data using write
+// or prepare_write/commit_write, then call next until it returns error::unexpected_end. Incomplete message is scanned
+// only once, scanning continues where it stopped when more data arrive, and the message is decoded only after all of
+// its bytes are present. Pointers into buffer memory from the previous message become invalid on the next call.
+template <typename T>
+class incremental_reader : public buffer
+{
+public:
+	static_assert( std::is_class_v<T> && std::is_aggregate_v<T>, "incremental_reader requires a struct message type" );
+
+	incremental_reader() SBP_NOEXCEPT { _state.start( &detail::layout_of<T>::node ); }
+
+	// Returns error::unexpected_end when the next message has not been fully received yet, any other error means the
+	// stream is corrupted and the reader has to be reset
+	error next( T &msg ) SBP_NOEXCEPT;
+
+	void reset( bool freeMemory = true ) SBP_NOEXCEPT
+	{
+		buffer::reset( freeMemory );
+		_state.start( &detail::layout_of<T>::node );
+	}
+
+private:
+	detail::scan_state _state;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+inline error incremental_reader<T>::next( T &msg ) SBP_NOEXCEPT
+{
+	// Drop already decoded messages before more data are appended
+	if ( tell() == size() || tell() >= capacity() / 2 )
+		compact();
+
+	if ( auto err = detail::scan( _state, data() + tell(), size() - tell() ) )
+		return err;
+
+	auto end = tell() + _state.offset;
+	auto err = sbp::read( static_cast<buffer &>( *this ), msg );
+
+	if ( !err && tell() != end )
+		err = { error::corrupted_data };
+
+	seek( end );
+	_state.start( &detail::layout_of<T>::node );
+	return err;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+// Ext type of the record log footer
+constexpr int8_t record_footer_type = 127;
+
+// Stored in the record log footer, which is always the last value in the log
+struct record_footer final
+{
+	uint64_t indexOffset;
+	uint64_t numRecords;
+};
+
+} // namespace detail
+
+// Writes messages as framed records (each record is a single bin value holding the message), finish then appends
+// an index of record offsets and a fixed-size footer, so records can be looked up without decoding the whole log
+template <typename Buffer>
+class record_writer final
+{
+public:
+	explicit record_writer( Buffer &output ) SBP_NOEXCEPT : _output( output ) { }
+
+	record_writer( const record_writer & ) = delete;
+
+	record_writer &operator=( const record_writer & ) = delete;
+
+	// Returns index of the record
+	template <typename T> size_t write( const T &msg ) SBP_NOEXCEPT;
+
+	// Writes offset index and footer, no more records should be written afterwards
+	void finish() SBP_NOEXCEPT;
+
+	// Number of records written so far
+	size_t size() const SBP_NOEXCEPT { return _index.size() / sizeof( uint64_t ); }
+
+private:
+	Buffer &_output;
+	uint64_t _offset = 0;
+
+	// Offsets of records
+	buffer _index;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer>
+template <typename T>
+inline size_t record_writer<Buffer>::write( const T &msg ) SBP_NOEXCEPT
+{
+	_index.write( _offset );
+
+	// Exact size is known up front, so the message can be written directly behind the frame header
+	auto numBytes = packed_size( msg );
+	detail::write_bin_header( _output, numBytes );
+	sbp::write( _output, msg );
+
+	_offset += detail::bin_header_size( numBytes ) + numBytes;
+	return size() - 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Buffer>
+inline void record_writer<Buffer>::finish() SBP_NOEXCEPT
+{
+	detail::record_footer footer = { _offset, size() };
+	detail::write_bin( _output, _index.data(), _index.size() );
+	detail::write_ext<sizeof( footer )>( _output, detail::record_footer_type, &footer );
+
+	_offset += detail::bin_header_size( _index.size() ) + _index.size();
+	_offset += detail::ext_header_size( sizeof( footer ) ) + sizeof( footer );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Random access to records of a finished record log (memory mapped file...), nothing is copied
+class record_reader final
+{
+public:
+	record_reader( const void *data, size_t size ) SBP_NOEXCEPT;
+
+	error valid() const SBP_NOEXCEPT { return _error; }
+
+	// Number of records
+	size_t size() const SBP_NOEXCEPT { return _numRecords; }
+
+	// Read-only view of a single record, empty when index is out of range
+	buffer record( size_t index ) const SBP_NOEXCEPT;
+
+	template <typename T> error read( size_t index, T &msg ) const SBP_NOEXCEPT;
+
+	// Returned by lower_bound when a probed record cannot be decoded
+	static constexpr size_t npos = size_t( -1 );
+
+	// Binary search in records sorted by member at KeyIndex, returns index of the first record with key not less than
+	// given key (or size() if there is none, npos if a probed record is corrupted). Only the key member of probed
+	// records is decoded.
+	template <typename T, size_t KeyIndex, typename K> size_t lower_bound( const K &key ) const SBP_NOEXCEPT;
+
+private:
+	uint64_t offset( size_t index ) const SBP_NOEXCEPT;
+
+	const uint8_t *_data = nullptr;
+	const uint8_t *_index = nullptr;
+	size_t _indexOffset = 0;
+	size_t _numRecords = 0;
+	error _error;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+inline record_reader::record_reader( const void *data, size_t size ) SBP_NOEXCEPT
+{
+	_data = static_cast<const uint8_t *>( data );
+
+	// Footer is fixext 16 at the very end
+	constexpr size_t footerSize = detail::ext_header_size( sizeof( detail::record_footer ) ) + sizeof( detail::record_footer );
+	if ( size < footerSize )
+	{
+		_error = { error::unexpected_end };
+		return;
+	}
+
+	buffer footerView( _data + size - footerSize, footerSize );
+	const void *footerData = nullptr;
+	if ( ( _error = detail::read_ext<sizeof( detail::record_footer ), detail::record_footer_type>( footerView, footerData ) ) )
+		return;
+
+	detail::record_footer footer;
+	memcpy( &footer, footerData, sizeof( footer ) );
+
+	if ( footer.indexOffset >= size - footerSize )
+	{
+		_error = { error::corrupted_data };
+		return;
+	}
+
+	buffer indexView( _data + footer.indexOffset, size - footerSize - footer.indexOffset );
+	const uint64_t *offsets = nullptr;
+	size_t numOffsets = 0;
+	if ( ( _error = detail::read_packed( indexView, offsets, numOffsets ) ) )
+		return;
+
+	if ( numOffsets != footer.numRecords )
+	{
+		_error = { error::corrupted_data };
+		return;
+	}
+
+	_index = reinterpret_cast<const uint8_t *>( offsets );
+	_indexOffset = static_cast<size_t>( footer.indexOffset );
+	_numRecords = numOffsets;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SBP_FORCE_INLINE uint64_t record_reader::offset( size_t index ) const SBP_NOEXCEPT
+{
+	// Index is not aligned
+	uint64_t result;
+	memcpy( &result, _index + index * sizeof( uint64_t ), sizeof( result ) );
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline buffer record_reader::record( size_t index ) const SBP_NOEXCEPT
+{
+	auto recordOffset = ( index < _numRecords ) ? offset( index ) : _indexOffset;
+	if ( recordOffset >= _indexOffset )
+		return buffer( _data, 0 );
+
+	buffer frame( _data + recordOffset, _indexOffset - static_cast<size_t>( recordOffset ) );
+
+	const void *payload = nullptr;
+	size_t numBytes = 0;
+	if ( detail::read_bin( frame, payload, numBytes ) )
+		return buffer( _data, 0 );
+
+	return buffer( payload, numBytes );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+inline error record_reader::read( size_t index, T &msg ) const SBP_NOEXCEPT
+{
+	if ( index >= _numRecords )
+		return { error::unexpected_end };
+
+	auto view = record( index );
+	return sbp::read( view, msg );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, size_t KeyIndex, typename K>
+inline size_t record_reader::lower_bound( const K &key ) const SBP_NOEXCEPT
+{
+	size_t first = 0;
+	size_t count = _numRecords;
+
+	while ( count > 0 )
+	{
+		auto step = count / 2;
+		auto view = record( first + step );
+
+		T msg = { };
+		if ( read_fields<T, KeyIndex>( view, msg ) )
+			return npos;
+
+		if ( detail::member_at<KeyIndex>( msg ) < key )
+		{
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+			count = step;
+	}
+
+	return first;
+}
+
+#if defined(SBP_STL_VECTOR)
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class value_tape;
+
+// Single value of a value_tape, cheap to copy. Views of missing values (index out of range, unknown key...) are
+// invalid, so lookups can be chained without checking every step.
+class value_view final
+{
+public:
+	enum value_type : uint8_t { invalid, nil, boolean, int_, uint_, float_, str, bin, ext, array, map };
+
+	value_view() SBP_NOEXCEPT = default;
+
+	value_type type() const SBP_NOEXCEPT;
+
+	// Number of array elements, map entries, bytes of str, bin and ext data, or bytes of number
+	size_t size() const SBP_NOEXCEPT;
+
+	// Data of str, bin and ext directly in buffer memory (numbers are in wire byte order)
+	const uint8_t *data() const SBP_NOEXCEPT;
+
+	int8_t ext_type() const SBP_NOEXCEPT { return ( type() == ext ) ? static_cast<int8_t>( data()[-1] ) : 0; }
+
+	// Encoded bytes of the whole value including nested values, e.g. to forward it without decoding
+	const uint8_t *raw_data() const SBP_NOEXCEPT;
+
+	size_t raw_size() const SBP_NOEXCEPT;
+
+	// Element of array
+	value_view operator[]( size_t index ) const SBP_NOEXCEPT;
+
+	// Key and value of map entry
+	value_view key( size_t index ) const SBP_NOEXCEPT;
+
+	value_view value( size_t index ) const SBP_NOEXCEPT;
+
+	// Value of map entry with str key
+	value_view find( const char *key, size_t length ) const SBP_NOEXCEPT;
+
+	// Decodes the value by typed readers, struct members start at this value
+	template <typename T> error read( T &result ) const SBP_NOEXCEPT;
+
+private:
+	friend class value_tape;
+
+	value_view( const value_tape *tape, size_t index ) SBP_NOEXCEPT : _tape( tape ), _index( static_cast<uint32_t>( index ) ) { }
 
-	if ( b.read<int8_t>() != TypeID )
-		return { error::corrupted_data };
+	value_view child( size_t index, value_type parentType, size_t numChildren ) const SBP_NOEXCEPT;
 
-	value = b.seek( b.tell() + NumBytes );
-	return b.valid();
-}
+	const value_tape *_tape = nullptr;
+	uint32_t _index = 0;
+};
 
-//---------------------------------------------------------------------------------------------------------------------
-template <typename T, typename... Tail>
-error read_multiple( buffer &b, T &value, Tail &... tail ) SBP_NOEXCEPT
+// Schema-less view of all values in a buffer. Parse builds a tape holding type, position and length of every value
+// in a single pass without decoding or copying anything, children of arrays and maps are stored next to each other,
+// so any of them is reached in constant time. Buffer memory has to stay unchanged while the tape is used.
+class value_tape final
 {
-	error err;
-
-	if constexpr ( std::is_enum_v<T> )
-		err = read( b, std::underlying_type_t<T>( value ) );
-	else
-		err = read( b, value );
+public:
+	// Parses values from the read cursor to the end of buffer memory, read cursor is moved to the end. Tape keeps its
+	// memory, so parsing similar buffers does not allocate anything.
+	error parse( buffer &b );
 
-	if constexpr ( sizeof...( Tail ) > 0 )
-	{
-		if ( auto err = read_multiple( b, tail... ) )
-			return err;
-	}
+	void clear() SBP_NOEXCEPT;
 
-	return err;
-}
+	// Number of top level values (structs are written member by member, so every member is a top level value)
+	size_t size() const SBP_NOEXCEPT { return _roots.size(); }
 
-} // namespace sbp::detail
+	value_view operator[]( size_t index ) const SBP_NOEXCEPT { return ( index < _roots.size() ) ? value_view( this, _roots[index] ) : value_view(); }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+private:
+	friend class value_view;
 
-#if defined(SBP_MSVC)
-	#if defined(_ARRAY_) && !defined(SBP_STL_ARRAY)
-		#define SBP_STL_ARRAY
-	#endif
+	struct entry final
+	{
+		// Offset of the header, and offset after the value including nested values
+		uint32_t offset;
+		uint32_t end;
 
-	#if defined(_MAP_) && !defined(SBP_STL_MAP)
-		#define SBP_STL_MAP
-	#endif
+		// See value_view::size
+		uint32_t length;
 
-	#if defined(_STRING_) && !defined(SBP_STL_STRING)
-		#define SBP_STL_STRING
-	#endif
+		// Index of the first child entry (keys and values of maps are interleaved)
+		uint32_t first;
 
-	#if defined(_STRING_VIEW_) && !defined(SBP_STL_STRING_VIEW)
-		#define SBP_STL_STRING_VIEW
-	#endif
+		value_view::value_type type;
+	};
 
-	#if defined(_UNORDERED_MAP_) && !defined(SBP_STL_UNORDERED_MAP)
-		#define SBP_STL_UNORDERED_MAP
-	#endif
+	// Array or map, whose children are being parsed
+	struct pending final
+	{
+		uint32_t owner;
+		uint32_t next;
+		uint32_t remaining;
+	};
 
-	#if defined(_VECTOR_) && !defined(SBP_STL_VECTOR)
-		#define SBP_STL_VECTOR
-	#endif
-#endif
+	error build( const uint8_t *data, size_t size );
 
-namespace sbp::detail {
+	const uint8_t *_data = nullptr;
+	size_t _size = 0;
 
-#if defined(SBP_STL_ARRAY)
-//---------------------------------------------------------------------------------------------------------------------
-template <typename T, size_t NumValues>
-SBP_FORCE_INLINE void write( buffer &b, const std::array<T, NumValues> &value ) SBP_NOEXCEPT { write_array( b, value.data(), NumValues ); }
+	std::vector<entry> _entries;
+	std::vector<uint32_t> _roots;
+	std::vector<pending> _pending;
+};
 
 //---------------------------------------------------------------------------------------------------------------------
-template <typename T, size_t NumValues>
-SBP_FORCE_INLINE error read( buffer &b, std::array<T, NumValues> &value ) SBP_NOEXCEPT
+inline error value_tape::parse( buffer &b )
 {
-	size_t numValues = 0;
-	if ( auto err = read_array_length( b, numValues ) )
-		return err;
+	clear();
 
-	if ( numValues != NumValues )
-		return { error::corrupted_data };
+	size_t size = b.size() - b.tell();
 
-	for ( size_t i = 0; i < NumValues; ++i )
+	// Entries use 32-bit offsets
+	if ( size > 0xffffffffu )
+		return { error::buffer_full };
+
+	if ( auto err = build( b.data() + b.tell(), size ) )
 	{
-		if ( auto err = read( b, value[i] ) )
-			return err;
+		clear();
+		return err;
 	}
 
-	return b.valid();
+	b.seek( b.size() );
+	return { error::none };
 }
-#endif
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-#if defined(SBP_STL_MAP)
-//---------------------------------------------------------------------------------------------------------------------
-template <typename K, typename T, typename P, typename A>
-SBP_FORCE_INLINE void write( buffer &b, const std::map<K, T, P, A> &value ) SBP_NOEXCEPT { write_map( b, value ); }
 
 //---------------------------------------------------------------------------------------------------------------------
-template <typename K, typename T, typename P, typename A>
-SBP_FORCE_INLINE error read( buffer &b, std::map<K, T, P, A> &value ) SBP_NOEXCEPT
+inline error value_tape::build( const uint8_t *data, size_t size )
 {
-	using Type = std::remove_reference_t<decltype( value )>;
-	return read_map<Type, typename Type::key_type, typename Type::mapped_type>( b, value );
-}
-#endif
+	using hi = detail::header_info;
+	using vt = value_view::value_type;
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Value types indexed by header families (fixint is fixed up by its sign)
+	constexpr vt types[] = { vt::invalid, vt::nil, vt::boolean, vt::uint_, vt::int_, vt::uint_, vt::float_, vt::str, vt::bin, vt::ext, vt::array, vt::map };
 
-#if defined(SBP_STL_UNORDERED_MAP)
-//---------------------------------------------------------------------------------------------------------------------
-template <typename K, typename T, typename H, typename EQ, typename A>
-SBP_FORCE_INLINE void write( buffer &b, const std::unordered_map<K, T, H, EQ, A> &value ) SBP_NOEXCEPT { write_map( b, value ); }
+	const uint8_t *cursor = data;
+	const uint8_t *end = data + size;
 
-//---------------------------------------------------------------------------------------------------------------------
-template <typename K, typename T, typename H, typename EQ, typename A>
-SBP_FORCE_INLINE error read( buffer &b, std::unordered_map<K, T, H, EQ, A> &value ) SBP_NOEXCEPT { return read_map( b, value ); }
-#endif
+	// Children of pending arrays and maps, which have not been parsed yet
+	size_t numOutstanding = 0;
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	while ( cursor < end )
+	{
+		const auto &info = detail::header_infos.entries[*cursor];
+		if ( info.family == hi::invalid )
+			return { error::corrupted_data };
 
-#if defined(SBP_STL_STRING)
-//---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE void write( buffer &b, const std::string &value ) SBP_NOEXCEPT { write_str( b, value.c_str(), value.length() ); }
+		size_t available = static_cast<size_t>( end - cursor ) - 1;
+		if ( info.lengthBytes > available )
+			return { error::unexpected_end };
+
+		size_t length = info.lengthBytes ? detail::load_length( cursor + 1, info.lengthBytes ) : info.length;
+		available -= info.lengthBytes;
+
+		entry e = { static_cast<uint32_t>( cursor - data ), 0, static_cast<uint32_t>( length ), 0, types[info.family] };
+		size_t numChildren = 0;
+
+		// This value fills one of the outstanding children
+		if ( !_pending.empty() )
+			--numOutstanding;
+
+		if ( info.family == hi::array || info.family == hi::map )
+		{
+			// Every value takes at least a byte, so corrupted counts cannot make the tape larger than the data (children
+			// promised by enclosing arrays and maps still need their bytes too)
+			numChildren = ( info.family == hi::map ) ? length * 2 : length;
+			if ( numOutstanding > available || numChildren > available - numOutstanding )
+				return { error::unexpected_end };
+
+			numOutstanding += numChildren;
+
+			cursor += 1u + info.lengthBytes;
+		}
+		else
+		{
+			size_t payload = info.payload + length;
+			if ( payload > available )
+				return { error::unexpected_end };
+
+			if ( info.family == hi::fixint && info.value < 0 )
+				e.type = vt::int_;
+
+			// Ext type byte is not a part of ext data
+			e.length = static_cast<uint32_t>( ( info.family == hi::ext ) ? payload - 1 : payload );
+			cursor += 1u + info.lengthBytes + payload;
+		}
+
+		e.end = static_cast<uint32_t>( cursor - data );
+
+		size_t index = _entries.size();
+		if ( _pending.empty() )
+		{
+			_roots.push_back( static_cast<uint32_t>( index ) );
+			_entries.push_back( e );
+		}
+		else
+		{
+			auto &parent = _pending.back();
+			index = parent.next++;
+			--parent.remaining;
+			_entries[index] = e;
+		}
+
+		if ( numChildren > 0 )
+		{
+			auto first = static_cast<uint32_t>( _entries.size() );
+			_entries[index].first = first;
+			_entries.resize( _entries.size() + numChildren );
+			_pending.push_back( { static_cast<uint32_t>( index ), first, static_cast<uint32_t>( numChildren ) } );
+			continue;
+		}
+
+		// Close arrays and maps, whose last value has just been parsed
+		while ( !_pending.empty() && _pending.back().remaining == 0 )
+		{
+			_entries[_pending.back().owner].end = static_cast<uint32_t>( cursor - data );
+			_pending.pop_back();
+		}
+	}
+
+	if ( !_pending.empty() )
+		return { error::unexpected_end };
+
+	_data = data;
+	_size = size;
+	return { error::none };
+}
 
 //---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE error read( buffer &b, std::string &value ) SBP_NOEXCEPT
+inline void value_tape::clear() SBP_NOEXCEPT
 {
-	size_t length = 0;
-	if ( auto err = read_string_length( b, length ) )
-		return err;
-
-	value.resize( length );
-	b.read( value.data(), length );
-	return b.valid();
+	_data = nullptr;
+	_size = 0;
+	_entries.clear();
+	_roots.clear();
+	_pending.clear();
 }
-#endif
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//---------------------------------------------------------------------------------------------------------------------
+inline value_view::value_type value_view::type() const SBP_NOEXCEPT
+{
+	return _tape ? _tape->_entries[_index].type : invalid;
+}
 
-#if defined(SBP_STL_STRING_VIEW)
 //---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE void write( buffer &b, std::string_view value ) SBP_NOEXCEPT { write_str( b, value.data(), value.length() ); }
+inline size_t value_view::size() const SBP_NOEXCEPT
+{
+	return _tape ? _tape->_entries[_index].length : 0;
+}
 
 //---------------------------------------------------------------------------------------------------------------------
-SBP_FORCE_INLINE error read( buffer &b, std::string_view &value ) SBP_NOEXCEPT
+inline const uint8_t *value_view::data() const SBP_NOEXCEPT
 {
-	size_t length = 0;
-	if ( auto err = read_string_length( b, length ) )
-		return err;
+	if ( !_tape )
+		return nullptr;
 
-	value = std::string_view( reinterpret_cast<const char *>( b.seek( b.tell() + length ) ), length );
-	return b.valid();
+	const auto &e = _tape->_entries[_index];
+	const auto &info = detail::header_infos.entries[_tape->_data[e.offset]];
+	return _tape->_data + e.offset + 1 + info.lengthBytes + ( ( e.type == ext ) ? 1 : 0 );
 }
-#endif
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-#if defined(SBP_STL_VECTOR)
 //---------------------------------------------------------------------------------------------------------------------
-template <typename T, typename A>
-SBP_FORCE_INLINE void write( buffer &b, const std::vector<T, A> &value ) SBP_NOEXCEPT { write_array( b, value.data(), value.size() ); }
+inline const uint8_t *value_view::raw_data() const SBP_NOEXCEPT
+{
+	return _tape ? _tape->_data + _tape->_entries[_index].offset : nullptr;
+}
 
 //---------------------------------------------------------------------------------------------------------------------
-template <typename T, typename A>
-SBP_FORCE_INLINE error read( buffer &b, std::vector<T, A> &value ) SBP_NOEXCEPT
+inline size_t value_view::raw_size() const SBP_NOEXCEPT
 {
-	size_t numValues = 0;
-	if ( auto err = read_array_length( b, numValues ) )
-		return err;
+	return _tape ? _tape->_entries[_index].end - _tape->_entries[_index].offset : 0;
+}
 
-	value.clear();
-	value.reserve( value.size() + numValues );
-	for ( size_t i = 0; i < numValues; ++i )
-	{
-		if ( auto err = read( b, value.emplace_back() ) )
-			return err;
-	}
+//---------------------------------------------------------------------------------------------------------------------
+inline value_view value_view::child( size_t index, value_type parentType, size_t numChildren ) const SBP_NOEXCEPT
+{
+	if ( !_tape || _tape->_entries[_index].type != parentType || index >= numChildren )
+		return { };
 
-	return b.valid();
+	return { _tape, _tape->_entries[_index].first + index };
 }
-#endif
 
-} // namespace sbp::detail
+//---------------------------------------------------------------------------------------------------------------------
+inline value_view value_view::operator[]( size_t index ) const SBP_NOEXCEPT { return child( index, array, size() ); }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//---------------------------------------------------------------------------------------------------------------------
+inline value_view value_view::key( size_t index ) const SBP_NOEXCEPT { return child( index * 2, map, size() * 2 ); }
 
-namespace sbp {
+//---------------------------------------------------------------------------------------------------------------------
+inline value_view value_view::value( size_t index ) const SBP_NOEXCEPT { return child( index * 2 + 1, map, size() * 2 ); }
 
 //---------------------------------------------------------------------------------------------------------------------
-template <typename T>
-void write( buffer &b, const T &msg ) SBP_NOEXCEPT
+inline value_view value_view::find( const char *key, size_t length ) const SBP_NOEXCEPT
 {
-	if constexpr ( detail::has_n_members_v<T, 10> )
-	{
-		const auto &[m0, m1, m2, m3, m4, m5, m6, m7, m8, m9] = msg;
-		detail::write_multiple( b, m0, m1, m2, m3, m4, m5, m6, m7, m8, m9 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 9> )
-	{
-		const auto &[m0, m1, m2, m3, m4, m5, m6, m7, m8] = msg;
-		detail::write_multiple( b, m0, m1, m2, m3, m4, m5, m6, m7, m8 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 8> )
-	{
-		const auto &[m0, m1, m2, m3, m4, m5, m6, m7] = msg;
-		detail::write_multiple( b, m0, m1, m2, m3, m4, m5, m6, m7 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 7> )
-	{
-		const auto &[m0, m1, m2, m3, m4, m5, m6] = msg;
-		detail::write_multiple( b, m0, m1, m2, m3, m4, m5, m6 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 6> )
-	{
-		const auto &[m0, m1, m2, m3, m4, m5] = msg;
-		detail::write_multiple( b, m0, m1, m2, m3, m4, m5 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 5> )
-	{
-		const auto &[m0, m1, m2, m3, m4] = msg;
-		detail::write_multiple( b, m0, m1, m2, m3, m4 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 4> )
-	{
-		const auto &[m0, m1, m2, m3] = msg;
-		detail::write_multiple( b, m0, m1, m2, m3 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 3> )
-	{
-		const auto &[m0, m1, m2] = msg;
-		detail::write_multiple( b, m0, m1, m2 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 2> )
-	{
-		const auto &[m0, m1] = msg;
-		detail::write_multiple( b, m0, m1 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 1> )
+	if ( type() != map )
+		return { };
+
+	for ( size_t i = 0, numEntries = size(); i < numEntries; ++i )
 	{
-		const auto &[m0] = msg;
-		detail::write_multiple( b, m0 );
+		auto k = this->key( i );
+		if ( k.type() == str && k.size() == length && memcmp( k.data(), key, length ) == 0 )
+			return value( i );
 	}
+
+	return { };
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 template <typename T>
-error read( buffer &b, T &msg ) SBP_NOEXCEPT
+inline error value_view::read( T &result ) const SBP_NOEXCEPT
 {
-	if constexpr ( detail::has_n_members_v<T, 10> )
-	{
-		auto &[m0, m1, m2, m3, m4, m5, m6, m7, m8, m9] = msg;
-		return detail::read_multiple( b, m0, m1, m2, m3, m4, m5, m6, m7, m8, m9 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 9> )
-	{
-		auto &[m0, m1, m2, m3, m4, m5, m6, m7, m8] = msg;
-		return detail::read_multiple( b, m0, m1, m2, m3, m4, m5, m6, m7, m8 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 8> )
-	{
-		auto &[m0, m1, m2, m3, m4, m5, m6, m7] = msg;
-		return detail::read_multiple( b, m0, m1, m2, m3, m4, m5, m6, m7 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 7> )
-	{
-		auto &[m0, m1, m2, m3, m4, m5, m6] = msg;
-		return detail::read_multiple( b, m0, m1, m2, m3, m4, m5, m6 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 6> )
-	{
-		auto &[m0, m1, m2, m3, m4, m5] = msg;
-		return detail::read_multiple( b, m0, m1, m2, m3, m4, m5 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 5> )
-	{
-		auto &[m0, m1, m2, m3, m4] = msg;
-		return detail::read_multiple( b, m0, m1, m2, m3, m4 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 4> )
-	{
-		auto &[m0, m1, m2, m3] = msg;
-		return detail::read_multiple( b, m0, m1, m2, m3 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 3> )
-	{
-		auto &[m0, m1, m2] = msg;
-		return detail::read_multiple( b, m0, m1, m2 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 2> )
-	{
-		auto &[m0, m1] = msg;
-		return detail::read_multiple( b, m0, m1 );
-	}
-	else if constexpr ( detail::has_n_members_v<T, 1> )
-	{
-		auto &[m0] = msg;
-		return detail::read_multiple( b, m0 );
-	}
+	if ( !_tape )
+		return { error::unexpected_end };
 
-	return b.valid();
+	// Struct members might follow this value, so the view ends where the tape ends
+	auto offset = _tape->_entries[_index].offset;
+	buffer view( _tape->_data + offset, _tape->_size - offset );
+	return detail::read_multiple( view, result );
 }
+#endif
 
 } // namespace sbp
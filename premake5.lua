@@ -6,7 +6,7 @@ workspace "sbp"
 	architecture "x86_64"
 
 	-- Configuration settings
-	configurations { "Debug", "Release" }
+	configurations { "Debug", "Release", "BigEndian" }
 
 	-- Debug configuration
 	filter { "configurations:Debug" }
@@ -20,6 +20,12 @@ workspace "sbp"
 		optimize "Speed"
 		inlining "Auto"
 
+	-- Release build storing values in big-endian byte order
+	filter { "configurations:BigEndian" }
+		defines { "NDEBUG", "SBP_BIG_ENDIAN" }
+		optimize "Speed"
+		inlining "Auto"
+
 	filter { "language:not C#" }
 		defines { "_CRT_SECURE_NO_WARNINGS" }
 		characterset ("MBCS")
@@ -4,12 +4,18 @@
 #include <iostream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 #include <map>
+#include <memory_resource>
 #include <unordered_map>
 
+#define SBP_PACKED_ARRAYS
+#define SBP_STL_MEMORY_RESOURCE
 #include <sbp/sbp.hpp>
+#include <sbp/io.hpp>
+#include <sbp/lz.hpp>
 
 //---------------------------------------------------------------------------------------------------------------------
 void PrintBuffer( const sbp::buffer &buff, size_t size = size_t( -1 ) )
@@ -79,48 +85,1593 @@ void TestWriteReadPerformance( std::string_view text, sbp::buffer &b, size_t cyc
 		PrintBuffer( b );
 	}
 
+	// Touch buffer memory once, so page faults are not counted to the first timed pass
+	b.reset( false );
+	for ( size_t i = 0; i < opsPerCycle; ++i ) sbp::write( b, msg );
+
+	// Write
+	{
+		std::string str = std::string( text ) + " W";
+		Stopwatch sw{ str.c_str() };
+
+		for ( size_t j = 0; j < cycles; ++j )
+		{
+			b.reset( false );
+			for ( size_t i = 0; i < opsPerCycle; ++i ) sbp::write( b, msg );
+		}
+	}
+
+	// Write (unchecked)
+	{
+		std::string str = std::string( text ) + " WU";
+		Stopwatch sw{ str.c_str() };
+
+		for ( size_t j = 0; j < cycles; ++j )
+		{
+			b.reset( false );
+			for ( size_t i = 0; i < opsPerCycle; ++i ) sbp::write_unchecked( b, msg );
+		}
+	}
+
+	// Read
+	{
+		std::string str = std::string( text ) + " R";
+		Stopwatch sw{ str.c_str() };
+
+		bool error = false;
+		for ( size_t j = 0; j < cycles && !error; ++j )
+		{
+			b.seek( 0 );
+			for ( size_t i = 0; i < opsPerCycle; ++i )
+			{
+				if ( sbp::read( b, msg ) != sbp::error::none )
+				{
+					error = true;
+					break;
+				}
+			}
+		}
+
+		if ( error )
+			std::cout << "deserialization error!" << std::endl;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+void TestBatchPerformance( std::string_view text, sbp::buffer &b, size_t cycles, size_t batchSize )
+{
+	std::vector<T> batch;
+	batch.reserve( batchSize );
+
 	// Write
 	{
-		std::string str = std::string( text ) + " W";
-		Stopwatch sw{ str.c_str() };
+		std::string str = std::string( text ) + " W";
+		Stopwatch sw{ str.c_str() };
+
+		for ( size_t j = 0; j < cycles; ++j )
+		{
+			b.reset( false );
+			sbp::detail::write( b, batch );
+		}
+	}
+
+#if defined(SBP_STL_THREAD)
+	// Write (parallel)
+	{
+		std::string str = std::string( text ) + " PW";
+		Stopwatch sw{ str.c_str() };
+
+		for ( size_t j = 0; j < cycles; ++j )
+		{
+			b.reset( false );
+			sbp::write_parallel( b, batch );
+		}
+	}
+#endif
+
+	// Read messages written one after another
+	b.reset( false );
+	for ( const auto &msg : batch )
+		sbp::write( b, msg );
+
+	{
+		std::string str = std::string( text ) + " R";
+		Stopwatch sw{ str.c_str() };
+
+		for ( size_t j = 0; j < cycles; ++j )
+		{
+			b.seek( 0 );
+			for ( auto &msg : batch )
+				sbp::read( b, msg );
+		}
+	}
+
+	// Parse whole batch into a schema-less tape
+	{
+		std::string str = std::string( text ) + " T";
+		Stopwatch sw{ str.c_str() };
+
+		sbp::value_tape tape;
+		for ( size_t j = 0; j < cycles; ++j )
+		{
+			b.seek( 0 );
+			if ( tape.parse( b ) != sbp::error::none )
+			{
+				std::cout << "tape error!" << std::endl;
+				break;
+			}
+		}
+	}
+
+	// Compress whole batch
+	sbp::buffer packed, unpacked;
+	{
+		std::string str = std::string( text ) + " C";
+		Stopwatch sw{ str.c_str() };
+
+		for ( size_t j = 0; j < cycles; ++j )
+		{
+			packed.reset( false );
+			sbp::compress( b.data(), b.size(), packed );
+		}
+	}
+
+	{
+		std::string str = std::string( text ) + " D";
+		Stopwatch sw{ str.c_str() };
+
+		for ( size_t j = 0; j < cycles; ++j )
+		{
+			unpacked.reset( false );
+			if ( sbp::decompress( packed.data(), packed.size(), unpacked ) != sbp::error::none )
+			{
+				std::cout << "decompression error!" << std::endl;
+				break;
+			}
+		}
+	}
+
+	if ( unpacked.size() != b.size() || memcmp( unpacked.data(), b.data(), b.size() ) != 0 )
+		std::cout << "decompression mismatch!" << std::endl;
+
+#if defined(SBP_STL_THREAD)
+	// Read (parallel)
+	{
+		std::string str = std::string( text ) + " PR";
+		Stopwatch sw{ str.c_str() };
+
+		for ( size_t j = 0; j < cycles; ++j )
+		{
+			b.seek( 0 );
+			if ( sbp::read_parallel( b, batch ) != sbp::error::none )
+			{
+				std::cout << "deserialization error!" << std::endl;
+				break;
+			}
+		}
+	}
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+void TestInterningPerformance( std::string_view text, sbp::buffer &b, size_t cycles, size_t batchSize )
+{
+	std::vector<T> batch;
+	batch.reserve( batchSize );
+
+	// Write and read with repeated strings interned
+	{
+		std::string str = std::string( text ) + " IW";
+		Stopwatch sw{ str.c_str() };
+
+		for ( size_t j = 0; j < cycles; ++j )
+		{
+			b.reset( false );
+			sbp::interning_writer<sbp::buffer> writer( b );
+			for ( const auto &msg : batch )
+				sbp::write( writer, msg );
+		}
+	}
+
+	{
+		std::string str = std::string( text ) + " IR";
+		Stopwatch sw{ str.c_str() };
+
+		sbp::string_table strings;
+		b.use_strings( &strings );
+
+		bool failed = false;
+		for ( size_t j = 0; j < cycles; ++j )
+		{
+			b.seek( 0 );
+			strings.clear();
+			for ( auto &msg : batch )
+				failed |= ( sbp::read( b, msg ) != sbp::error::none );
+		}
+
+		if ( failed )
+			std::cout << "deserialization error!" << std::endl;
+
+		// Table is gone after this scope, later reads must not resolve references through it
+		b.use_strings( nullptr );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Decodes every message into a new object, once with the default memory resource and once with an arena released
+// after every batch of messages (messages of a batch are alive at the same time)
+template <typename T>
+void TestArenaPerformance( std::string_view text, sbp::buffer &b, size_t cycles, size_t opsPerCycle, const T &sample,
+                           size_t batchSize )
+{
+	b.reset( false );
+	for ( size_t i = 0; i < opsPerCycle; ++i ) sbp::write( b, sample );
+
+	std::vector<T> batch;
+	batch.reserve( batchSize );
+
+	{
+		std::string str = std::string( text ) + " R";
+		Stopwatch sw{ str.c_str() };
+
+		bool error = false;
+		for ( size_t j = 0; j < cycles && !error; ++j )
+		{
+			b.seek( 0 );
+			for ( size_t i = 0; i < opsPerCycle && !error; i += batchSize )
+			{
+				for ( size_t k = 0; k < batchSize && !error; ++k )
+					error = ( sbp::read( b, batch.emplace_back() ) != sbp::error::none );
+
+				batch.clear();
+			}
+		}
+
+		if ( error )
+			std::cout << "deserialization error!" << std::endl;
+	}
+
+	{
+		std::string str = std::string( text ) + " RA";
+		Stopwatch sw{ str.c_str() };
+
+		sbp::arena arena;
+		bool error = false;
+		for ( size_t j = 0; j < cycles && !error; ++j )
+		{
+			b.seek( 0 );
+			for ( size_t i = 0; i < opsPerCycle && !error; i += batchSize )
+			{
+				for ( size_t k = 0; k < batchSize && !error; ++k )
+					error = ( sbp::read( b, batch.emplace_back(), &arena ) != sbp::error::none );
+
+				batch.clear();
+				arena.release();
+			}
+		}
+
+		if ( error )
+			std::cout << "deserialization error!" << std::endl;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Decodes messages of varying shapes, every one into a new object and then all of them into a single reused object
+template <typename T>
+void TestReusePerformance( std::string_view text, sbp::buffer &b, size_t cycles, const std::vector<T> &messages )
+{
+	b.reset( false );
+	for ( const auto &msg : messages ) sbp::write( b, msg );
+
+	{
+		std::string str = std::string( text ) + " R";
+		Stopwatch sw{ str.c_str() };
+
+		bool error = false;
+		for ( size_t j = 0; j < cycles && !error; ++j )
+		{
+			b.seek( 0 );
+			for ( size_t i = 0; i < messages.size() && !error; ++i )
+			{
+				T msg;
+				error = ( sbp::read( b, msg ) != sbp::error::none );
+			}
+		}
+
+		if ( error )
+			std::cout << "deserialization error!" << std::endl;
+	}
+
+	{
+		std::string str = std::string( text ) + " RU";
+		Stopwatch sw{ str.c_str() };
+
+		T msg;
+		bool error = false;
+		for ( size_t j = 0; j < cycles && !error; ++j )
+		{
+			b.seek( 0 );
+			for ( size_t i = 0; i < messages.size() && !error; ++i )
+				error = ( sbp::read( b, msg ) != sbp::error::none );
+		}
+
+		if ( error )
+			std::cout << "deserialization error!" << std::endl;
+	}
+}
+
+struct Matrix3x3
+{
+	float m[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+};
+
+SBP_EXTENSION( Matrix3x3, 0 )
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Number of failed correctness checks, main returns non-zero when any check failed
+int numFailures = 0;
+
+//---------------------------------------------------------------------------------------------------------------------
+void Check( bool condition, const char *what )
+{
+	if ( condition )
+		return;
+
+	std::cout << what << " failed!" << std::endl;
+	++numFailures;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestFixedSize()
+{
+	// Packed array of extensions uses ext header, which is longer than bin header, largest id makes the message
+	// as long as its bound
+	struct Message final
+	{
+		uint32_t id = 0xffffffffu;
+		std::array<Matrix3x3, 3> matrices;
+	};
+
+	Message msg;
+	constexpr size_t maxSize = sbp::max_packed_size_v<Message>;
+	Check( sbp::packed_size( msg ) <= maxSize, "max_packed_size_v of packed extensions" );
+
+	// Bytes past the bound must stay untouched
+	uint8_t data[maxSize + 16];
+	memset( data, 0xcd, sizeof( data ) );
+
+	size_t numBytes = sbp::write_fixed( data, msg );
+	Check( numBytes == sbp::packed_size( msg ) && numBytes <= maxSize, "write_fixed of packed extensions" );
+
+	bool untouched = true;
+	for ( size_t i = maxSize; i < sizeof( data ); ++i )
+		untouched = untouched && ( data[i] == 0xcd );
+
+	Check( untouched, "write_fixed bound of packed extensions" );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestBufferView()
+{
+	uint8_t data[100];
+	for ( size_t i = 0; i < sizeof( data ); ++i ) data[i] = uint8_t( i );
+
+	// Read-only view has no capacity of its own, released block must still hold all of its data
+	{
+		sbp::buffer view( data, sizeof( data ) );
+		auto block = view.release();
+		Check( block.size == sizeof( data ) && block.capacity >= block.size && memcmp( block.data, data, sizeof( data ) ) == 0, "release of buffer view" );
+		block.deleter( block.data );
+	}
+
+	{
+		sbp::buffer view( data, sizeof( data ) );
+		view.reserve( 10 );
+		view.write( uint8_t( 100 ) );
+		Check( view.size() == sizeof( data ) + 1 && memcmp( view.data(), data, sizeof( data ) ) == 0 && view.data()[100] == 100, "reserve of buffer view" );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+size_t numAdoptedDeletes = 0;
+
+void DeleteAdopted( uint8_t *data )
+{
+	++numAdoptedDeletes;
+	delete[] data;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestBufferOwnership()
+{
+	uint8_t data[1000];
+	for ( size_t i = 0; i < sizeof( data ); ++i ) data[i] = uint8_t( i * 7 );
+
+	// Small buffer lives in inline storage, moving has to copy it instead of taking the pointer
+	{
+		sbp::buffer small;
+		small.write( data, 100 );
+		uint8_t first;
+		small.read( &first, 1 );
+
+		sbp::buffer moved( std::move( small ) );
+		Check( moved.size() == 100 && moved.tell() == 1 && moved.data() != small.data() && memcmp( moved.data(), data, 100 ) == 0, "move of inline buffer" );
+		Check( small.size() == 0 && small.tell() == 0, "moved from inline buffer" );
+
+		small.write( data, 10 );
+		Check( small.size() == 10 && moved.size() == 100 && memcmp( moved.data(), data, 100 ) == 0, "reuse of moved from inline buffer" );
+	}
+
+	// Heap buffer hands over its memory block
+	{
+		sbp::buffer large, moved;
+		large.write( data, sizeof( data ) );
+		moved.write( data, sizeof( data ) );
+		const uint8_t *block = large.data();
+
+		moved = std::move( large );
+		Check( moved.data() == block && moved.size() == sizeof( data ) && memcmp( moved.data(), data, sizeof( data ) ) == 0, "move assignment of heap buffer" );
+		Check( large.size() == 0 && large.data() != block && large.capacity() < sizeof( data ), "moved from heap buffer" );
+
+		sbp::buffer small;
+		small.write( data, 10 );
+		moved = std::move( small );
+		Check( moved.size() == 10 && moved.data() != small.data() && memcmp( moved.data(), data, 10 ) == 0, "move assignment of inline buffer" );
+	}
+
+	// Released inline storage is copied to a heap block the caller owns
+	{
+		sbp::buffer small;
+		small.write( data, 100 );
+		auto block = small.release();
+		Check( block.size == 100 && block.capacity >= block.size && block.data != small.data() && block.deleter == sbp::buffer::default_deleter && memcmp( block.data, data, 100 ) == 0, "release of inline buffer" );
+		Check( small.size() == 0, "released buffer is empty" );
+		block.deleter( block.data );
+	}
+
+	// Adopted block is freed by its own deleter exactly once, whether replaced by growth, moved or destroyed
+	{
+		numAdoptedDeletes = 0;
+		{
+			sbp::buffer b;
+			auto block = new uint8_t[100];
+			b.adopt( block, 0, 100, DeleteAdopted );
+			Check( numAdoptedDeletes == 0, "adopt does not call the deleter" );
+
+			b.write( data, 50 );
+			sbp::buffer moved( std::move( b ) );
+			Check( numAdoptedDeletes == 0 && moved.data() == block, "move keeps adopted block" );
+
+			moved.write( data, sizeof( data ) );
+			Check( numAdoptedDeletes == 1 && memcmp( moved.data(), data, 50 ) == 0, "growth frees adopted block" );
+		}
+		Check( numAdoptedDeletes == 1, "adopted block freed once after growth" );
+
+		numAdoptedDeletes = 0;
+		{
+			sbp::buffer b;
+			b.adopt( new uint8_t[100], 0, 100, DeleteAdopted );
+			b.reset();
+			b.reset();
+		}
+		Check( numAdoptedDeletes == 1, "adopted block freed once by reset" );
+
+		numAdoptedDeletes = 0;
+		{
+			sbp::buffer b;
+			b.adopt( new uint8_t[100], 10, 100, DeleteAdopted );
+			auto block = b.release();
+			Check( numAdoptedDeletes == 0 && block.deleter == DeleteAdopted && block.size == 10, "release of adopted block" );
+			block.deleter( block.data );
+		}
+		Check( numAdoptedDeletes == 1, "released adopted block freed once by its owner" );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+struct MemorySource
+{
+	const uint8_t *data;
+	size_t size;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+size_t ReadFromMemory( void *userData, void *data, size_t maxBytes )
+{
+	auto &source = *static_cast<MemorySource *>( userData );
+	auto numBytes = ( source.size < maxBytes ) ? source.size : maxBytes;
+	memcpy( data, source.data, numBytes );
+	source.data += numBytes;
+	source.size -= numBytes;
+	return numBytes;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestStreamWindow()
+{
+	struct Message final
+	{
+		std::string_view text;
+	};
+
+	// str32 claiming almost 4 GB must fail instead of growing the window
+	{
+		const uint8_t data[] = { 0xdb, 0xf0, 0xff, 0xff, 0xff, 'a' };
+		MemorySource source = { data, sizeof( data ) };
+		sbp::stream_reader reader( ReadFromMemory, &source, 64, 1024 );
+
+		Message msg;
+		Check( sbp::read( reader, msg ) != sbp::error::none && reader.capacity() <= 1024, "stream_reader window limit" );
+	}
+
+	// Values up to the limit still grow the window
+	{
+		sbp::buffer b;
+		struct Owned final { std::string text; } owned = { std::string( 1000, 'x' ) };
+		sbp::write( b, owned );
+
+		MemorySource source = { b.data(), b.size() };
+		sbp::stream_reader reader( ReadFromMemory, &source, 64, 1024 );
+
+		Message msg;
+		Check( sbp::read( reader, msg ) == sbp::error::none && msg.text == owned.text, "stream_reader window growth" );
+	}
+
+	// Packed vectors are copied in chunks, they are not limited by the window
+	{
+		struct Packed final
+		{
+			std::vector<double> values;
+			std::vector<Matrix3x3> matrices;
+		} packed, result;
+
+		for ( int i = 0; i < 1000; ++i )
+			packed.values.push_back( i * 0.5 );
+
+		packed.matrices.resize( 100 );
+		packed.matrices[99].m[4] = 2.0f;
+
+		sbp::buffer b;
+		sbp::write( b, packed );
+
+		MemorySource source = { b.data(), b.size() };
+		sbp::stream_reader reader( ReadFromMemory, &source, 64, 1024 );
+
+		auto err = sbp::read( reader, result );
+		Check( !err && result.values == packed.values && result.matrices.size() == 100 && result.matrices[99].m[4] == 2.0f && reader.capacity() <= 1024, "stream_reader packed vectors" );
+	}
+
+	// Bin32 claiming almost 4 GB of doubles must fail without allocating them
+	{
+		const uint8_t data[] = { 0xc6, 0xf0, 0xff, 0xff, 0xff, 1, 2, 3, 4, 5, 6, 7, 8 };
+		sbp::buffer view( data, sizeof( data ) );
+
+		struct Doubles final { std::vector<double> values; } msg;
+		Check( sbp::read( view, msg ) != sbp::error::none && msg.values.size() <= 1, "packed vector length bound" );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestReadFields()
+{
+	// Structs are written without any header, so skipping containers of them has to follow their layout
+	struct Point final
+	{
+		int x;
+		std::string label;
+	};
+
+	struct Message final
+	{
+		uint32_t id = 0;
+		std::vector<std::vector<Point>> grid;
+		std::map<int, std::vector<Point>> paths;
+		double price = 0.0;
+	};
+
+	Message msg;
+	msg.id = 42;
+	msg.grid = { { { 1, "a" }, { 2, "b" } }, { { 3, "c" } } };
+	msg.paths = { { 7, { { 4, "d" }, { 5, "e" } } } };
+	msg.price = 1.25;
+
+	sbp::buffer b;
+	sbp::write( b, msg );
+
+	Message selected;
+	auto err = sbp::read_fields<Message, 0, 3>( b, selected );
+	Check( !err && selected.id == 42 && selected.price == 1.25 && selected.grid.empty() && b.tell() == b.size(), "read_fields past nested containers of structs" );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestSkip()
+{
+	// Header followed by numBytes of payload
+	auto value = []( std::initializer_list<uint8_t> header, size_t numBytes )
+	{
+		std::vector<uint8_t> bytes( header );
+		bytes.resize( bytes.size() + numBytes, 0x55 );
+		return bytes;
+	};
+
+	// Header with length field in wire order, rest of the header (ext type or nested values) and numBytes of payload
+	auto sized = []( uint8_t header, auto length, std::initializer_list<uint8_t> rest, size_t numBytes )
+	{
+		sbp::buffer b;
+		b.write( header, length );
+		b.write( rest.begin(), rest.size() );
+
+		std::vector<uint8_t> bytes( b.data(), b.data() + b.size() );
+		bytes.resize( bytes.size() + numBytes, 0x55 );
+		return bytes;
+	};
+
+	std::vector<std::vector<uint8_t>> values =
+	{
+		value( { 0x05 }, 0 ), value( { 0xe0 }, 0 ), value( { 0xc0 }, 0 ), value( { 0xc3 }, 0 ),
+		value( { 0xcc }, 1 ), value( { 0xcd }, 2 ), value( { 0xce }, 4 ), value( { 0xcf }, 8 ),
+		value( { 0xd0 }, 1 ), value( { 0xd1 }, 2 ), value( { 0xd2 }, 4 ), value( { 0xd3 }, 8 ),
+		value( { 0xca }, 4 ), value( { 0xcb }, 8 ),
+		value( { 0xa0 }, 0 ), value( { 0xa3 }, 3 ), value( { 0xbf }, 31 ),
+		sized( 0xd9, uint8_t( 200 ), { }, 200 ), sized( 0xda, uint16_t( 300 ), { }, 300 ), sized( 0xdb, uint32_t( 300 ), { }, 300 ),
+		sized( 0xc4, uint8_t( 3 ), { }, 3 ), sized( 0xc5, uint16_t( 256 ), { }, 256 ), sized( 0xc6, uint32_t( 7 ), { }, 7 ),
+		value( { 0xd4, 1 }, 1 ), value( { 0xd5, 1 }, 2 ), value( { 0xd6, 1 }, 4 ), value( { 0xd7, 1 }, 8 ), value( { 0xd8, 1 }, 16 ),
+		sized( 0xc7, uint8_t( 5 ), { 1 }, 5 ), sized( 0xc8, uint16_t( 256 ), { 1 }, 256 ), sized( 0xc9, uint32_t( 9 ), { 1 }, 9 ),
+		value( { 0x90 }, 0 ), value( { 0x80 }, 0 ),
+		// [ 1, "ab", [ nil, { 2: bin[1] } ] ], { "k": [ 3, 4 ], 5: fixext1 }, [ { []: {} }, false, [ [ 7 ] ] ], { "": [ 1, 2, 3 ] }
+		sized( 0xdc, uint16_t( 3 ), { 0x01, 0xa2, 'a', 'b', 0x92, 0xc0, 0x81, 0x02, 0xc4, 1, 0 }, 0 ),
+		sized( 0xdf, uint32_t( 2 ), { 0xa1, 'k', 0x92, 0x03, 0x04, 0x05, 0xd4, 1, 0 }, 0 ),
+		sized( 0xdd, uint32_t( 3 ), { 0x81, 0x90, 0x80, 0xc2, 0x91, 0x91, 0x07 }, 0 ),
+		sized( 0xde, uint16_t( 1 ), { 0xa0, 0x93, 0x01, 0x02, 0x03 }, 0 ),
+	};
+
+	// Each value followed by a marker, which has to be the next thing read after skipping
+	bool lands = true;
+	for ( const auto &bytes : values )
+	{
+		sbp::buffer b;
+		b.write( bytes.data(), bytes.size() );
+		b.write( uint8_t( 0x7f ) );
+
+		lands = lands && !sbp::skip( b ) && b.tell() == bytes.size() && b.read<uint8_t>() == 0x7f;
+	}
+
+	Check( lands, "skip of every header family" );
+
+	// All values in a row, over memory (fast path) and through a stream refilling one byte at a time (slow path)
+	sbp::buffer all;
+	for ( const auto &bytes : values )
+		all.write( bytes.data(), bytes.size() );
+
+	all.write( uint8_t( 0x7f ) );
+
+	bool skipped = true;
+	for ( size_t i = 0; i < values.size(); ++i )
+		skipped = skipped && !sbp::skip( all );
+
+	Check( skipped && all.tell() == all.size() - 1, "skip of consecutive values" );
+
+	MemorySource source = { all.data(), all.size() };
+	sbp::stream_reader reader( []( void *userData, void *data, size_t ) { return ReadFromMemory( userData, data, 1 ); }, &source, 64, 1024 );
+
+	skipped = true;
+	for ( size_t i = 0; i < values.size(); ++i )
+		skipped = skipped && !sbp::skip( reader );
+
+	Check( skipped && reader.read<uint8_t>() == 0x7f && source.size == 0, "skip through stream" );
+
+	// Every value cut at every position has to report the missing data
+	bool truncated = true;
+	for ( const auto &bytes : values )
+	{
+		for ( size_t size = 0; size < bytes.size(); ++size )
+		{
+			sbp::buffer view( bytes.data(), size );
+			truncated = truncated && sbp::skip( view ) == sbp::error::unexpected_end;
+		}
+	}
+
+	Check( truncated, "skip of truncated values" );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestRecordLog()
+{
+	struct Record final
+	{
+		uint32_t key;
+		double value;
+	};
+
+	sbp::buffer b;
+	sbp::record_writer<sbp::buffer> writer( b );
+	for ( uint32_t i = 0; i < 8; ++i )
+		writer.write( Record{ i * 10, i * 0.5 } );
+
+	writer.finish();
+
+	sbp::record_reader log( b.data(), b.size() );
+	Check( log.valid() == sbp::error::none && log.lower_bound<Record, 0>( 25u ) == 3, "record_reader lower_bound" );
+
+	// First probed record gets invalid header instead of its key
+	const_cast<uint8_t *>( log.record( 4 ).data() )[0] = 0xc1;
+	Check( log.lower_bound<Record, 0>( 25u ) == sbp::record_reader::npos, "record_reader lower_bound of corrupted record" );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestPackedArrays()
+{
+	// Lengths not divisible by SIMD block also go through the scalar tail when byte order is swapped
+	struct Message final
+	{
+		std::vector<uint16_t> shorts;
+		std::vector<double> doubles;
+		std::vector<uint32_t> ints;
+	};
+
+	Message msg;
+	for ( uint32_t i = 0; i < 37; ++i )
+	{
+		msg.shorts.push_back( uint16_t( i * 1000 + 1 ) );
+		msg.doubles.push_back( i * 0.25 );
+		msg.ints.push_back( 0x01020300u + i );
+	}
+
+	sbp::buffer b;
+	sbp::write( b, msg );
+
+	Message result;
+	auto err = sbp::read( b, result );
+	Check( !err && result.shorts == msg.shorts && result.doubles == msg.doubles && result.ints == msg.ints, "packed arrays round trip" );
+
+	// Last element of the last array ends the message
+	const uint8_t *last = b.data() + b.size() - 4;
+#if defined(SBP_BIG_ENDIAN)
+	Check( last[0] == 0x01 && last[1] == 0x02 && last[2] == 0x03 && last[3] == 36, "packed arrays byte order" );
+#else
+	Check( last[3] == 0x01 && last[2] == 0x02 && last[1] == 0x03 && last[0] == 36, "packed arrays byte order" );
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+bool DeltaRoundTrip( const sbp::delta_vector<T> &values )
+{
+	struct Message final
+	{
+		uint8_t tag = 7;
+		sbp::delta_vector<T> values;
+	};
+
+	Message msg, result;
+	msg.values = values;
+
+	sbp::buffer b;
+	sbp::write( b, msg );
+
+	auto err = sbp::read( b, result );
+	return !err && result.tag == msg.tag && result.values == msg.values && b.tell() == b.size() && b.size() == sbp::packed_size( msg );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestDeltaVectors()
+{
+	// Lengths cover empty and single value, partial 4-lane groups of the vectorized prefix sum and multiple blocks
+	for ( size_t numValues : { 0, 1, 2, 5, 8, 127, 128, 129, 300 } )
+	{
+		sbp::delta_vector<uint64_t> sorted, wide, unsorted;
+		sbp::delta_vector<int32_t> negative;
+
+		for ( size_t i = 0; i < numValues; ++i )
+		{
+			sorted.push_back( 1000000 + i * i * 3 );
+			wide.push_back( ( uint64_t( 1 ) << 57 ) * ( i % 100 ) + i );
+			unsorted.push_back( ( i % 3 ) ? ~uint64_t( 0 ) - i : i );
+			negative.push_back( int32_t( ( i % 2 ) ? -int32_t( i * 7 ) : int32_t( i * 5 ) ) );
+		}
+
+		Check( DeltaRoundTrip( sorted ), "delta_vector round trip of sorted values" );
+		Check( DeltaRoundTrip( wide ), "delta_vector round trip of deltas wider than 56 bits" );
+		Check( DeltaRoundTrip( unsorted ), "delta_vector round trip of unsorted values" );
+		Check( DeltaRoundTrip( negative ), "delta_vector round trip of negative values" );
+	}
+
+	// Count does not fit into 32 bits, values are never touched
+	if constexpr ( sizeof( size_t ) > sizeof( uint32_t ) )
+	{
+		uint64_t values[1] = { };
+		sbp::buffer b;
+		sbp::detail::write_delta( b, values, size_t( 0xffffffffu ) + 1 );
+
+		sbp::delta_vector<uint64_t> result;
+		Check( b.size() == 1 && sbp::detail::read( b, result ) == sbp::error::corrupted_data, "delta_vector count limit" );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool WriteToBuffer( void *userData, const void *data, size_t numBytes )
+{
+	static_cast<sbp::buffer *>( userData )->write( data, numBytes );
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool CompressionRoundTrip( const std::string &data )
+{
+	sbp::buffer packed, unpacked;
+	sbp::compress( data.data(), data.size(), packed );
+
+	auto err = sbp::decompress( packed.data(), packed.size(), unpacked );
+	return !err && unpacked.size() == data.size() && memcmp( unpacked.data(), data.data(), data.size() ) == 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestCompression()
+{
+	std::string repeated;
+	while ( repeated.size() < 100000 )
+		repeated += "Lorem ipsum dolor sit amet " + std::to_string( repeated.size() % 1000 ) + ", ";
+
+	std::string random( 70000, 0 );
+	uint32_t seed = 12345;
+	for ( auto &c : random )
+	{
+		seed = seed * 1664525u + 1013904223u;
+		c = char( seed >> 24 );
+	}
+
+	// Matches farther than the largest offset, and data split into multiple frames
+	std::string distant = random + repeated + random;
+	std::string large( 17 * 1024 * 1024, 'x' );
+	for ( size_t i = 0; i < large.size(); i += 4093 )
+		large[i] = char( i );
+
+	Check( CompressionRoundTrip( "" ), "compress round trip of empty data" );
+	Check( CompressionRoundTrip( "abc" ), "compress round trip of short data" );
+	Check( CompressionRoundTrip( repeated ), "compress round trip of repetitive data" );
+	Check( CompressionRoundTrip( random ), "compress round trip of random data" );
+	Check( CompressionRoundTrip( distant ), "compress round trip of distant matches" );
+	Check( CompressionRoundTrip( large ), "compress round trip of multiple frames" );
+
+	// Truncated frame must be refused
+	{
+		sbp::buffer packed, unpacked;
+		sbp::compress( repeated.data(), repeated.size(), packed );
+		Check( sbp::decompress( packed.data(), packed.size() - 1, unpacked ) != sbp::error::none, "decompress of truncated data" );
+	}
+
+	// Streams with window smaller than some messages
+	struct Message final
+	{
+		uint32_t id = 0;
+		std::string text;
+	};
+
+	sbp::buffer stream;
+	{
+		sbp::compressed_writer writer( WriteToBuffer, &stream, sbp::default_compression_level, 4096 );
+		for ( uint32_t i = 0; i < 100; ++i )
+			sbp::write( writer, Message{ i, repeated.substr( 0, i * 97 ) } );
+
+		Check( writer.flush() == sbp::error::none, "compressed_writer flush" );
+	}
+
+	MemorySource source = { stream.data(), stream.size() };
+	sbp::compressed_reader reader( ReadFromMemory, &source, 4096 );
+
+	bool matches = true;
+	for ( uint32_t i = 0; i < 100 && matches; ++i )
+	{
+		Message msg;
+		matches = !sbp::read( reader, msg ) && msg.id == i && msg.text == repeated.substr( 0, i * 97 );
+	}
+
+	Check( matches && reader.status() == sbp::error::none, "compressed stream round trip" );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+struct FailingSink
+{
+	sbp::buffer data;
+	size_t maxBytes;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+bool WriteUntilFull( void *userData, const void *data, size_t numBytes )
+{
+	auto &sink = *static_cast<FailingSink *>( userData );
+	if ( sink.data.size() + numBytes > sink.maxBytes )
+		return false;
+
+	sink.data.write( data, numBytes );
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+struct Document final
+{
+	uint32_t id = 0;
+	std::string title;
+	std::vector<uint8_t> blob;
+	std::vector<double> values;
+
+	bool operator==( const Document &other ) const
+	{
+		return id == other.id && title == other.title && blob == other.blob && values == other.values;
+	}
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+std::vector<Document> MakeDocuments()
+{
+	std::vector<Document> documents( 20 );
+	for ( uint32_t i = 0; i < documents.size(); ++i )
+	{
+		documents[i].id = i;
+		documents[i].title = std::string( i * 13, char( 'a' + i ) );
+		documents[i].blob.resize( i * 151 );
+		for ( size_t j = 0; j < documents[i].blob.size(); ++j ) documents[i].blob[j] = uint8_t( i + j );
+		documents[i].values.assign( i * 7, i * 0.25 );
+	}
+
+	return documents;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestStreamWriter()
+{
+	auto documents = MakeDocuments();
+
+	sbp::buffer expected;
+	for ( const auto &document : documents )
+		sbp::write( expected, document );
+
+	// Window is much smaller than most messages and blobs, bytes must match a plain buffer
+	{
+		sbp::buffer stream;
+		{
+			sbp::stream_writer writer( WriteToBuffer, &stream, 64 );
+			for ( const auto &document : documents )
+				sbp::write( writer, document );
+
+			Check( writer.flush() == sbp::error::none && writer.size() == expected.size(), "stream_writer flush" );
+		}
+
+		Check( stream.size() == expected.size() && memcmp( stream.data(), expected.data(), expected.size() ) == 0, "stream_writer bytes" );
+
+		MemorySource source = { stream.data(), stream.size() };
+		sbp::stream_reader reader( ReadFromMemory, &source, 64, 1024 );
+
+		bool matches = true;
+		for ( const auto &document : documents )
+		{
+			Document result;
+			matches = matches && !sbp::read( reader, result ) && result == document;
+		}
+
+		Check( matches, "stream_writer round trip" );
+	}
+
+	// Failing callback is reported by flush and valid, nothing is passed to it afterwards
+	{
+		FailingSink sink = { sbp::buffer(), 1000 };
+		sbp::stream_writer writer( WriteUntilFull, &sink, 64 );
+		for ( const auto &document : documents )
+			sbp::write( writer, document );
+
+		Check( writer.flush() == sbp::error::io_error && writer.valid() == sbp::error::io_error, "stream_writer failing callback" );
+		Check( sink.data.size() <= sink.maxBytes && memcmp( sink.data.data(), expected.data(), sink.data.size() ) == 0, "stream_writer data before failure" );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestFileIo()
+{
+#if !defined(_WIN32)
+	auto documents = MakeDocuments();
+
+	// File written through fd_writer, read back with fd_reader and mapped_file
+	{
+		char path[] = "/tmp/sbp_test_XXXXXX";
+		int fd = mkstemp( path );
+		Check( fd >= 0, "temporary file" );
+		if ( fd < 0 )
+			return;
+
+		{
+			sbp::fd_writer writer( fd, 100 );
+			for ( const auto &document : documents )
+				sbp::write( writer, document );
+
+			Check( writer.flush() == sbp::error::none, "fd_writer flush" );
+		}
+
+		lseek( fd, 0, SEEK_SET );
+		{
+			sbp::fd_reader reader( fd, 100, 4096 );
+
+			bool matches = true;
+			for ( const auto &document : documents )
+			{
+				Document result;
+				matches = matches && !sbp::read( reader, result ) && result == document;
+			}
+
+			Document extra;
+			Check( matches && sbp::read( reader, extra ) != sbp::error::none, "fd_reader round trip" );
+		}
+		close( fd );
+
+		{
+			sbp::mapped_file file( path );
+			Check( file.is_open(), "mapped_file open" );
+
+			auto view = file.view();
+			bool matches = true;
+			for ( const auto &document : documents )
+			{
+				Document result;
+				matches = matches && !sbp::read( view, result ) && result == document;
+			}
+
+			Check( matches && view.tell() == file.size(), "mapped_file round trip" );
+		}
+
+		unlink( path );
+		Check( !sbp::mapped_file( path ).is_open(), "mapped_file missing file" );
+	}
+
+	// Pipe keeps data in order even when the reader gets it in small pieces
+	{
+		int fds[2];
+		Check( pipe( fds ) == 0, "pipe" );
+
+		{
+			sbp::fd_writer writer( fds[1], 64 );
+			for ( const auto &document : documents )
+				sbp::write( writer, document );
+
+			Check( writer.flush() == sbp::error::none, "fd_writer pipe flush" );
+		}
+		close( fds[1] );
+
+		sbp::fd_reader reader( fds[0], 64, 4096 );
+
+		bool matches = true;
+		for ( const auto &document : documents )
+		{
+			Document result;
+			matches = matches && !sbp::read( reader, result ) && result == document;
+		}
+
+		Check( matches, "fd_reader pipe round trip" );
+		close( fds[0] );
+
+		// Closed descriptor fails the writer
+		sbp::fd_writer writer( fds[1] );
+		sbp::write( writer, documents[5] );
+		Check( writer.flush() == sbp::error::io_error, "fd_writer closed descriptor" );
+	}
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestColumns()
+{
+	// First column is an array, its count decides number of elements (no packed column, streams have to read all
+	// columns in small pieces)
+	struct Item final
+	{
+		std::string name;
+		std::string label;
+	};
+
+	struct Message final
+	{
+		sbp::column_vector<Item> items;
+	};
+
+	// Array claiming 2^31 elements with no data behind it must fail without allocating them
+	{
+		const uint8_t data[] = { 0x92, 0xdd, 0xff, 0xff, 0xff, 0x7f };
+		sbp::buffer view( data, sizeof( data ) );
+
+		Message msg;
+		Check( sbp::read( view, msg ) != sbp::error::none && msg.items.size() <= sizeof( data ), "column_vector count bound" );
+	}
+
+	// Streams still read columns with more elements than bytes the window can ever hold
+	{
+		Message msg;
+		for ( int32_t i = 0; i < 300; ++i )
+			msg.items.push_back( { std::to_string( i ), "label " + std::to_string( i ) } );
+
+		sbp::buffer b;
+		sbp::write( b, msg );
+
+		MemorySource source = { b.data(), b.size() };
+		sbp::stream_reader reader( ReadFromMemory, &source, 64, 64 );
+
+		Message result;
+		bool matches = !sbp::read( reader, result ) && result.items.size() == msg.items.size();
+		for ( size_t i = 0; matches && i < msg.items.size(); ++i )
+			matches = result.items[i].name == msg.items[i].name && result.items[i].label == msg.items[i].label;
+
+		Check( matches, "column_vector from stream" );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestArena()
+{
+	struct Message final
+	{
+		std::pmr::string symbol;
+		std::pmr::vector<std::pmr::string> tags;
+		std::pmr::map<int, std::pmr::vector<double>> series;
+	};
 
-		for ( size_t j = 0; j < cycles; ++j )
+	Message msg;
+	msg.symbol = "a symbol too long for small string buffer";
+	msg.tags = { "first tag of the message", "second tag of the message" };
+	msg.series = { { 1, { 1.0, 2.0, 3.0 } }, { 2, { 4.0, 5.0 } } };
+
+	sbp::buffer b;
+	sbp::write( b, msg );
+
+	sbp::arena arena( 256 );
+	size_t capacity = 0;
+
+	// The second message is decoded into memory left by the first one
+	for ( int i = 0; i < 2; ++i )
+	{
 		{
-			b.reset( false );
-			for ( size_t i = 0; i < opsPerCycle; ++i ) sbp::write( b, msg );
+			Message result;
+			b.seek( 0 );
+
+			auto err = sbp::read( b, result, &arena );
+			bool inArena = result.symbol.get_allocator().resource() == &arena && result.tags[0].get_allocator().resource() == &arena
+				&& result.series.get_allocator().resource() == &arena && result.series[1].get_allocator().resource() == &arena;
+
+			Check( !err && result.symbol == msg.symbol && result.tags == msg.tags && result.series == msg.series, "read with arena" );
+			Check( inArena && arena.size() > 0, "containers bound to arena" );
 		}
+
+		Check( i == 0 || arena.capacity() == capacity, "arena reuse" );
+		capacity = arena.capacity();
+		arena.release();
 	}
+}
 
-	// Read
+//---------------------------------------------------------------------------------------------------------------------
+void TestReuse()
+{
+	struct Item final
 	{
-		std::string str = std::string( text ) + " R";
-		Stopwatch sw{ str.c_str() };
+		std::string name;
+		std::vector<int32_t> values;
+	};
 
-		bool error = false;
-		for ( size_t j = 0; j < cycles && !error; ++j )
+	struct Message final
+	{
+		std::vector<Item> items;
+		std::map<int32_t, std::string> names;
+	};
+
+	Message large, small;
+	large.items = { { "first item name too long for small string buffer", { 1, 2, 3 } }, { "second item", { 4 } }, { "third", { } } };
+	large.names = { { 1, "one" }, { 2, "two" }, { 3, "three" } };
+	small.items = { { "other", { 5, 6 } } };
+	small.names = { { 2, "other two" }, { 4, "four" } };
+
+	sbp::buffer b;
+	sbp::write( b, large );
+	sbp::write( b, small );
+	sbp::write( b, large );
+
+	auto equal = []( const Message &first, const Message &second )
+	{
+		bool result = first.items.size() == second.items.size() && first.names == second.names;
+		for ( size_t i = 0; result && i < first.items.size(); ++i )
+			result = first.items[i].name == second.items[i].name && first.items[i].values == second.items[i].values;
+
+		return result;
+	};
+
+	// Shrinking and growing again must leave nothing from previous values
+	Message msg;
+	Check( !sbp::read( b, msg ) && equal( msg, large ), "read into empty object" );
+
+	const char *name = msg.items[0].name.data();
+	Check( !sbp::read( b, msg ) && equal( msg, small ), "read into larger object" );
+	Check( !sbp::read( b, msg ) && equal( msg, large ), "read into smaller object" );
+
+	// First element was never destroyed, so its string kept its memory
+	Check( msg.items[0].name.data() == name, "read keeps element memory" );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestMapCounts()
+{
+	struct HashMessage final
+	{
+		std::unordered_map<uint32_t, uint32_t> values;
+	};
+
+	struct FlatMessage final
+	{
+		sbp::flat_map<uint32_t, uint32_t> values;
+	};
+
+	// Map claiming 2^31 entries followed by a single one must fail without allocating for all of them
+	const uint8_t data[] = { 0xdf, 0xff, 0xff, 0xff, 0x7f, 0x01, 0x01 };
+	{
+		sbp::buffer view( data, sizeof( data ) );
+		HashMessage msg;
+		Check( sbp::read( view, msg ) != sbp::error::none, "unordered_map count bound" );
+	}
+
+	{
+		sbp::buffer view( data, sizeof( data ) );
+		FlatMessage msg;
+		Check( sbp::read( view, msg ) != sbp::error::none && msg.values.size() <= sizeof( data ), "flat_map count bound" );
+	}
+
+	// Streams still read maps with more entries than bytes the window can ever hold
+	HashMessage hashed;
+	FlatMessage flat;
+	for ( uint32_t i = 0; i < 300; ++i )
+	{
+		hashed.values[i * 3] = i;
+		flat.values.push_back( { i * 3, i } );
+	}
+
+	sbp::buffer b;
+	sbp::write( b, hashed );
+	sbp::write( b, flat );
+
+	MemorySource source = { b.data(), b.size() };
+	sbp::stream_reader reader( ReadFromMemory, &source, 64, 64 );
+
+	HashMessage hashedResult;
+	FlatMessage flatResult;
+	Check( !sbp::read( reader, hashedResult ) && hashedResult.values == hashed.values, "unordered_map from stream" );
+	Check( !sbp::read( reader, flatResult ) && flatResult.values == flat.values, "flat_map from stream" );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestInterning()
+{
+	struct Quote final
+	{
+		std::string symbol;
+		std::string_view venue;
+		uint32_t size = 0;
+	};
+
+	sbp::buffer b;
+	{
+		sbp::interning_writer<sbp::buffer> writer( b );
+		for ( uint32_t i = 0; i < 100; ++i )
+			sbp::write( writer, Quote{ "SYMBOL" + std::to_string( i % 7 ), ( i % 2 ) ? "VENUE-A" : "VENUE-B", i } );
+	}
+
+	// Views of referenced strings point to their first occurrence in buffer memory
+	{
+		sbp::string_table strings;
+		b.use_strings( &strings );
+
+		bool matches = true;
+		for ( uint32_t i = 0; i < 100; ++i )
 		{
-			b.seek( 0 );
-			for ( size_t i = 0; i < opsPerCycle; ++i )
-			{
-				if ( sbp::read( b, msg ) != sbp::error::none )
-				{
-					error = true;
-					break;
-				}
-			}
+			Quote quote;
+			matches = matches && !sbp::read( b, quote ) && quote.symbol == "SYMBOL" + std::to_string( i % 7 ) && quote.venue == ( ( i % 2 ) ? "VENUE-A" : "VENUE-B" ) && quote.size == i;
 		}
 
-		if ( error )
-			std::cout << "deserialization error!" << std::endl;
+		Check( matches && strings.size() == 9 && b.tell() == b.size(), "interned strings round trip" );
+		b.use_strings( nullptr );
+	}
+
+	// Stream window is refilled and compacted, so views kept by the table would dangle
+	{
+		MemorySource source = { b.data(), b.size() };
+		sbp::stream_reader reader( ReadFromMemory, &source, 64, 64 );
+
+		sbp::string_table strings;
+		reader.use_strings( &strings );
+
+		// Window already holds data, so the header of the first string can be looked at
+		Quote quote;
+		Check( !reader.eof() && sbp::read( reader, quote ) == sbp::error::corrupted_data && strings.size() == 0, "interned strings through stream_reader" );
 	}
 }
 
-struct Matrix3x3
+//---------------------------------------------------------------------------------------------------------------------
+void TestValueTape()
 {
-	float m[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+	struct Message final
+	{
+		uint32_t id = 42;
+		std::vector<std::string> tags = { "a", "b" };
+		std::map<int, double> prices = { { 1, 1.25 } };
+	};
+
+	sbp::buffer b;
+	sbp::write( b, Message() );
+
+	sbp::value_tape tape;
+	Check( tape.parse( b ) == sbp::error::none && tape.size() == 3 && tape[1].size() == 2 && tape[2].size() == 1, "value_tape parse" );
+
+	// Nested arrays each claiming almost all of the remaining bytes, together they claim far more than there are
+	std::vector<uint8_t> nested;
+	while ( nested.size() < 60000 )
+		nested.insert( nested.end(), { 0xdc, 0x7f, 0x7f } );
+
+	sbp::buffer view( nested.data(), nested.size() );
+	Check( tape.parse( view ) != sbp::error::none && tape.size() == 0, "value_tape bound of nested counts" );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestSpanWriter()
+{
+	// Empty containers have no memory, their null data must not be copied by any writer
+	struct Message final
+	{
+		uint32_t id = 7;
+		std::string name = "span writer";
+		std::vector<int32_t> values = { 1, 2, 3 };
+		std::vector<double> empty;
+		std::string emptyName;
+	};
+
+	Message msg;
+	sbp::buffer b;
+	sbp::write( b, msg );
+
+	size_t requiredSize = sbp::packed_size( msg );
+	Check( b.size() == requiredSize, "packed_size of message with empty containers" );
+
+	// Exactly sized block
+	{
+		std::vector<uint8_t> data( requiredSize );
+		size_t numBytes = 0;
+		auto err = sbp::write( data.data(), data.size(), msg, numBytes );
+		Check( !err && numBytes == requiredSize && memcmp( data.data(), b.data(), numBytes ) == 0, "write into exactly sized block" );
+	}
+
+	// Too small block reports the required size and bytes past its capacity stay untouched
+	for ( size_t capacity : { size_t( 0 ), size_t( 1 ), requiredSize / 2, requiredSize - 1 } )
+	{
+		std::vector<uint8_t> data( requiredSize + 16, 0xcd );
+		size_t numBytes = 0;
+		auto err = sbp::write( data.data(), capacity, msg, numBytes );
+
+		bool untouched = true;
+		for ( size_t i = capacity; i < data.size(); ++i )
+			untouched = untouched && ( data[i] == 0xcd );
+
+		Check( err == sbp::error::buffer_full && numBytes == requiredSize && untouched, "write into too small block" );
+	}
+
+	// Same bytes from the unchecked and stream writers
+	{
+		sbp::buffer unchecked;
+		sbp::write_unchecked( unchecked, msg );
+		Check( unchecked.size() == b.size() && memcmp( unchecked.data(), b.data(), b.size() ) == 0, "write_unchecked of empty containers" );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+struct Order final
+{
+	uint32_t id = 0;
+	std::string symbol;
+	std::vector<std::string> tags;
+	std::map<int, std::vector<int32_t>> levels;
+	double price = 0.0;
+
+	bool operator==( const Order &other ) const
+	{
+		return id == other.id && symbol == other.symbol && tags == other.tags && levels == other.levels && price == other.price;
+	}
 };
 
-SBP_EXTENSION( Matrix3x3, 0 )
+//---------------------------------------------------------------------------------------------------------------------
+void TestIncrementalReader()
+{
+	std::vector<Order> orders( 3 );
+	for ( uint32_t i = 0; i < orders.size(); ++i )
+	{
+		orders[i].id = i + 1;
+		orders[i].symbol = std::string( 10 + i * 50, char( 'a' + i ) );
+		orders[i].tags = { "tag", std::string( 40, 'x' ) };
+		orders[i].levels = { { 1, { 1, 2, 3 } }, { int( i ) + 2, std::vector<int32_t>( 20 * i, 7 ) } };
+		orders[i].price = i * 1.5;
+	}
+
+	sbp::buffer b;
+	std::vector<size_t> ends;
+	for ( const auto &order : orders )
+	{
+		sbp::write( b, order );
+		ends.push_back( b.size() );
+	}
+
+	// Messages must decode exactly when their last byte arrives, whatever pieces the data come in
+	for ( size_t chunkSize : { 1, 2, 7, 64, 1000 } )
+	{
+		sbp::incremental_reader<Order> reader;
+		std::vector<Order> decoded;
+		bool valid = true;
+
+		for ( size_t offset = 0; offset < b.size(); offset += chunkSize )
+		{
+			size_t numBytes = ( b.size() - offset < chunkSize ) ? ( b.size() - offset ) : chunkSize;
+			uint8_t *cursor = reader.prepare_write( numBytes );
+			memcpy( cursor, b.data() + offset, numBytes );
+			reader.commit_write( cursor + numBytes );
+
+			Order order;
+			sbp::error err;
+			while ( !( err = reader.next( order ) ) )
+				decoded.push_back( order );
+
+			size_t numComplete = 0;
+			while ( numComplete < ends.size() && ends[numComplete] <= offset + numBytes )
+				++numComplete;
+
+			valid = valid && ( err == sbp::error::unexpected_end ) && decoded.size() == numComplete;
+		}
+
+		Check( valid && decoded == orders, "incremental_reader pieces" );
+	}
+
+	// Compacting after a decoded message keeps the partial one behind it
+	{
+		sbp::incremental_reader<Order> reader;
+		size_t split = ends[0] + ( ends[1] - ends[0] ) / 2;
+		reader.write( b.data(), split );
+
+		Order first, second;
+		Check( !reader.next( first ) && first == orders[0], "incremental_reader first message" );
+		Check( reader.next( second ) == sbp::error::unexpected_end, "incremental_reader partial message" );
+
+		reader.compact();
+		reader.write( b.data() + split, ends[1] - split );
+		Check( !reader.next( second ) && second == orders[1] && reader.tell() == reader.size(), "incremental_reader compact" );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+struct Row final
+{
+	uint32_t id = 0;
+	std::string name;
+	std::vector<int32_t> values;
+	double price = 0.0;
+
+	bool operator==( const Row &other ) const
+	{
+		return id == other.id && name == other.name && values == other.values && price == other.price;
+	}
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+std::vector<Row> MakeRows( size_t numRows )
+{
+	std::vector<Row> rows( numRows );
+	for ( uint32_t i = 0; i < numRows; ++i )
+	{
+		rows[i].id = i * 2654435761u;
+		rows[i].name = std::string( i % 40, char( 'a' + i % 26 ) );
+		rows[i].values.assign( i % 7, int32_t( i ) - 1000 );
+		rows[i].price = i * 0.125;
+	}
+
+	return rows;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestWriteParallel()
+{
+	struct Table final
+	{
+		std::vector<Row> rows;
+	};
+
+	// Counts around and between chunk sizes, every thread count has to give the same bytes as a sequential write
+	bool matches = true;
+	for ( size_t numRows : { 0, 1, 4095, 4096, 4097, 3 * 4096 + 17, 40000 } )
+	{
+		Table table = { MakeRows( numRows ) };
+
+		sbp::buffer expected;
+		sbp::write( expected, table );
+
+		for ( size_t numThreads : { 1, 2, 3, 8 } )
+		{
+			sbp::buffer b;
+			b.write( uint8_t( 0x7f ) );
+			sbp::write_parallel( b, table.rows, numThreads );
+
+			matches = matches && b.size() == expected.size() + 1 && memcmp( b.data() + 1, expected.data(), expected.size() ) == 0;
+		}
+	}
+
+	Check( matches, "write_parallel bytes" );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestReadParallel()
+{
+	// Counts around and between slices of messages, results have to match a sequential read
+	bool matches = true;
+	for ( size_t numRows : { 0, 1, 255, 256, 257, 1000, 5000 } )
+	{
+		auto rows = MakeRows( numRows );
+
+		sbp::buffer b;
+		for ( const auto &row : rows )
+			sbp::write( b, row );
+
+		std::vector<Row> sequential( numRows );
+		for ( auto &row : sequential )
+			matches = matches && !sbp::read( b, row );
+
+		matches = matches && sequential == rows;
+
+		for ( size_t numThreads : { 1, 2, 3, 8 } )
+		{
+			// Existing messages get overwritten
+			std::vector<Row> result = MakeRows( 300 );
+			b.seek( 0 );
+
+			matches = matches && !sbp::read_parallel( b, result, numThreads ) && result == sequential && b.tell() == b.size();
+		}
+	}
+
+	Check( matches, "read_parallel results" );
+
+	// Corrupted message in the last slice fails the whole read
+	auto rows = MakeRows( 1000 );
+	sbp::buffer b;
+	for ( const auto &row : rows )
+		sbp::write( b, row );
+
+	sbp::buffer truncated( b.data(), b.size() - 1 );
+	std::vector<Row> result;
+	Check( sbp::read_parallel( truncated, result, 4 ) != sbp::error::none && truncated.tell() == 0, "read_parallel truncated input" );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TestCorrectness()
+{
+	TestFixedSize();
+	TestBufferView();
+	TestBufferOwnership();
+	TestStreamWindow();
+	TestReadFields();
+	TestSkip();
+	TestRecordLog();
+	TestPackedArrays();
+	TestDeltaVectors();
+	TestCompression();
+	TestStreamWriter();
+	TestFileIo();
+	TestColumns();
+	TestArena();
+	TestReuse();
+	TestMapCounts();
+	TestInterning();
+	TestValueTape();
+	TestSpanWriter();
+	TestIncrementalReader();
+	TestWriteParallel();
+	TestReadParallel();
+}
 
 //---------------------------------------------------------------------------------------------------------------------
 void TestPerformance()
@@ -167,11 +1718,145 @@ void TestPerformance()
 
 		TestWriteReadPerformance<Message>( "    ext", buffer, cycles, opsPerCycle );
 	}
+
+	/// Packed arrays
+	{
+		struct Message final
+		{
+			std::vector<float> values = std::vector<float>( 64, 1.0f );
+		};
+
+		TestWriteReadPerformance<Message>( " packed", buffer, cycles, opsPerCycle / 10 );
+	}
+
+	/// Delta encoded integers
+	{
+		struct Message final
+		{
+			sbp::delta_vector<uint64_t> timestamps = []
+			{
+				sbp::delta_vector<uint64_t> result( 64 );
+				for ( size_t i = 0; i < result.size(); ++i ) result[i] = 1700000000000000000ull + i * 1000;
+				return result;
+			}();
+		};
+
+		TestWriteReadPerformance<Message>( "  delta", buffer, cycles, opsPerCycle / 10 );
+	}
+
+	/// Columnar vector of structs
+	{
+		struct Tick final
+		{
+			uint64_t timestamp = 1700000000000ull;
+			double bid = 1.25;
+			double ask = 1.5;
+			int32_t size = 100;
+		};
+
+		struct Message final
+		{
+			sbp::column_vector<Tick> ticks = sbp::column_vector<Tick>( 64 );
+		};
+
+		TestWriteReadPerformance<Message>( " column", buffer, cycles, opsPerCycle / 10 );
+	}
+
+	/// Sorted flat map
+	{
+		struct Message final
+		{
+			sbp::flat_map<uint32_t, double> prices = []
+			{
+				sbp::flat_map<uint32_t, double> result( 64 );
+				for ( size_t i = 0; i < result.size(); ++i ) result[i] = { uint32_t( i * 10 ), 1.25 + i };
+				return result;
+			}();
+		};
+
+		TestWriteReadPerformance<Message>( "   flat", buffer, cycles, opsPerCycle / 10 );
+	}
+
+	/// Batch of messages
+	{
+		struct Message final
+		{
+			uint64_t id = 1234567890123;
+			double price = 1.25;
+			uint32_t quantity = 100;
+			std::string symbol = "SBP";
+		};
+
+		TestBatchPerformance<Message>( "  batch", buffer, cycles / 10, opsPerCycle );
+	}
+
+	/// Batch of messages with strings long enough to be interned
+	{
+		struct Message final
+		{
+			uint64_t id = 1234567890123;
+			double price = 1.25;
+			uint32_t quantity = 100;
+			std::string symbol = "SBP.L";
+			std::string venue = "XLON";
+			std::string_view currency = "GBP.X";
+		};
+
+		TestInterningPerformance<Message>( " intern", buffer, cycles / 10, opsPerCycle );
+	}
+
+	/// Std::pmr containers decoded through an arena
+	{
+		struct Message final
+		{
+			uint32_t id = 0;
+			std::pmr::string symbol;
+			std::pmr::vector<std::pmr::string> tags;
+			std::pmr::map<int, std::pmr::vector<double>> series;
+		};
+
+		Message sample;
+		sample.id = 42;
+		sample.symbol = "a symbol too long for small string buffer";
+		sample.tags = { "first tag of the message", "second tag of the message" };
+		sample.series = { { 1, { 1.0, 2.0, 3.0 } }, { 2, { 4.0, 5.0 } } };
+
+		TestArenaPerformance<Message>( "  arena", buffer, cycles / 10, opsPerCycle / 10, sample, 1000 );
+	}
+
+	/// Decoding into a reused object
+	{
+		struct Item final
+		{
+			std::string name;
+			std::vector<int32_t> values;
+		};
+
+		struct Message final
+		{
+			std::vector<Item> items;
+			std::map<int32_t, std::string> names;
+		};
+
+		// Shapes vary, so reused containers are sometimes larger and sometimes smaller than needed
+		std::vector<Message> messages( opsPerCycle / 100 );
+		for ( size_t i = 0; i < messages.size(); ++i )
+		{
+			for ( size_t k = 0; k < i % 7 + 1; ++k )
+			{
+				messages[i].items.push_back( { "item name too long for small string buffer", std::vector<int32_t>( k * 3 + 1, int32_t( i ) ) } );
+				messages[i].names[int32_t( k * 10 + i % 3 )] = "name too long for small string buffer";
+			}
+		}
+
+		TestReusePerformance<Message>( "  reuse", buffer, cycles / 10, messages );
+	}
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 int main( int argc, char *argv[] )
 {
+	TestCorrectness();
 	TestPerformance();
-	return 0;
+	return ( numFailures == 0 ) ? 0 : 1;
 }